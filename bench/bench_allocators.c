@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "contact_db.h"
+
+// The handle finds names through its index, and small databases keep the pointer moves of deletions short,
+// so the allocation paths dominate. The legacy functions still scan the whole database
+#define CONTACTS_PER_DATABASE 64
+#define NUM_OF_DATABASES 20000
+#define NUM_OF_CHURN_ROUNDS 1000000
+#define NUM_OF_RAW_BLOCKS 1000000
+// Every benchmark runs this many times, interleaved with the others, and the median is reported,
+// as single runs on a shared machine vary by a third
+#define NUM_OF_REPETITIONS 7
+
+static char names[CONTACTS_PER_DATABASE][MAX_NAMELEN + 1];
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static unsigned int next_random(unsigned int *state) {
+    // xorshift32, good enough to pick contacts
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// A benchmark returns the seconds its timed part took
+typedef struct BenchCase BenchCase;
+typedef double (*BenchFunction)(const BenchCase *bench);
+
+struct BenchCase {
+    const char *workload;
+    const char *variant;
+    BenchFunction run;
+    const ContactAllocator *allocator;
+    ArenaAllocator *arena; // released with arena_reset instead of freeing the blocks one by one, if set
+    long operations;
+    double seconds[NUM_OF_REPETITIONS];
+};
+
+static int compare_seconds(const void *a, const void *b) {
+    double difference = *(const double *) a - *(const double *) b;
+    return (difference > 0) - (difference < 0);
+}
+
+static void print_result(BenchCase *bench) {
+    qsort(bench->seconds, NUM_OF_REPETITIONS, sizeof(double), compare_seconds);
+    double median = bench->seconds[NUM_OF_REPETITIONS / 2];
+    printf("%-6s %-24s %14.1f %10.1f %10.1f\n", bench->workload, bench->variant,
+           median * 1e9 / bench->operations, bench->seconds[0] * 1e9 / bench->operations,
+           bench->seconds[NUM_OF_REPETITIONS - 1] * 1e9 / bench->operations);
+}
+
+// ============================
+// = Raw allocator throughput =
+// ============================
+
+static double bench_raw_allocator(const BenchCase *bench) {
+    static void *blocks[NUM_OF_RAW_BLOCKS];
+    const ContactAllocator *allocator = bench->allocator;
+
+    double start = now_seconds();
+    for (int i = 0; i < NUM_OF_RAW_BLOCKS; ++i) {
+        blocks[i] = allocator->allocate(allocator->context, sizeof(Contact));
+        if (blocks[i] == NULL) {
+            fprintf(stderr, "Allocation failed in the %s benchmark\n", bench->variant);
+            exit(EXIT_FAILURE);
+        }
+        ((Contact *) blocks[i])->name[0] = '\0';
+    }
+    if (bench->arena != NULL) {
+        arena_reset(bench->arena);
+    } else {
+        for (int i = 0; i < NUM_OF_RAW_BLOCKS; ++i) {
+            allocator->deallocate(allocator->context, blocks[i], sizeof(Contact));
+        }
+    }
+    return now_seconds() - start;
+}
+
+// ========================================
+// = Load and query: many small databases =
+// ========================================
+
+static double bench_load_legacy(const BenchCase *bench) {
+    (void) bench;
+    double start = now_seconds();
+    for (int d = 0; d < NUM_OF_DATABASES; ++d) {
+        Contact *database = NULL;
+        int contact_count = 0;
+        for (int i = 0; i < CONTACTS_PER_DATABASE; ++i) {
+            Contact *updated_database = add_contact(names[i], "+37060000000", "bench@example.com", database,
+                                                    &contact_count);
+            if (updated_database != NULL) {
+                database = updated_database;
+            }
+        }
+        free(database);
+    }
+    return now_seconds() - start;
+}
+
+static double bench_load_db(const BenchCase *bench) {
+    double start = now_seconds();
+    for (int d = 0; d < NUM_OF_DATABASES; ++d) {
+        ContactDB db;
+        contact_db_init(&db, bench->allocator);
+        for (int i = 0; i < CONTACTS_PER_DATABASE; ++i) {
+            if (contact_db_add(&db, names[i], "+37060000000", "bench@example.com") != CONTACT_OK) {
+                fprintf(stderr, "Adding a contact failed in the %s benchmark\n", bench->variant);
+                exit(EXIT_FAILURE);
+            }
+        }
+        // The whole arena is released at once, instead of contact by contact
+        if (bench->arena != NULL) {
+            arena_reset(bench->arena);
+        } else {
+            contact_db_free(&db);
+        }
+    }
+    return now_seconds() - start;
+}
+
+// ==================================
+// = Churn: delete and add contacts =
+// ==================================
+
+static double bench_churn_legacy(const BenchCase *bench) {
+    (void) bench;
+    Contact *database = NULL;
+    int contact_count = 0;
+    for (int i = 0; i < CONTACTS_PER_DATABASE; ++i) {
+        database = add_contact(names[i], "+37060000000", "bench@example.com", database, &contact_count);
+    }
+
+    unsigned int random_state = 2463534242U;
+    double start = now_seconds();
+    for (int r = 0; r < NUM_OF_CHURN_ROUNDS; ++r) {
+        const char *name = names[next_random(&random_state) % CONTACTS_PER_DATABASE];
+        database = delete_contact(name, database, &contact_count);
+        database = add_contact(name, "+37060000000", "bench@example.com", database, &contact_count);
+    }
+    double seconds = now_seconds() - start;
+    free(database);
+    return seconds;
+}
+
+static double bench_churn_db(const BenchCase *bench) {
+    ContactDB db;
+    contact_db_init(&db, bench->allocator);
+    for (int i = 0; i < CONTACTS_PER_DATABASE; ++i) {
+        contact_db_add(&db, names[i], "+37060000000", "bench@example.com");
+    }
+
+    unsigned int random_state = 2463534242U;
+    double start = now_seconds();
+    for (int r = 0; r < NUM_OF_CHURN_ROUNDS; ++r) {
+        const char *name = names[next_random(&random_state) % CONTACTS_PER_DATABASE];
+        contact_db_delete(&db, name);
+        if (contact_db_add(&db, name, "+37060000000", "bench@example.com") != CONTACT_OK) {
+            fprintf(stderr, "Adding a contact failed in the %s benchmark\n", bench->variant);
+            exit(EXIT_FAILURE);
+        }
+    }
+    double seconds = now_seconds() - start;
+    contact_db_free(&db);
+    return seconds;
+}
+
+int main(void) {
+    for (int i = 0; i < CONTACTS_PER_DATABASE; ++i) {
+        snprintf(names[i], sizeof(names[i]), "%d Bench Contact", i);
+    }
+
+    ArenaAllocator *arena = arena_create(1 << 20);
+    PoolAllocator *pool = pool_create(sizeof(Contact), 1024);
+    if (arena == NULL || pool == NULL) {
+        fprintf(stderr, "Failed to create the allocators\n");
+        return EXIT_FAILURE;
+    }
+    ContactAllocator arena_interface = arena_as_allocator(arena);
+    ContactAllocator pool_interface = pool_as_allocator(pool);
+
+    const long raw_operations = 2L * NUM_OF_RAW_BLOCKS;
+    const long load_operations = (long) NUM_OF_DATABASES * CONTACTS_PER_DATABASE;
+    const long churn_operations = 2L * NUM_OF_CHURN_ROUNDS;
+    BenchCase benches[] = {
+            {"raw", "system", bench_raw_allocator, system_allocator(), NULL, raw_operations, {0}},
+            {"raw", "arena", bench_raw_allocator, &arena_interface, arena, raw_operations, {0}},
+            {"raw", "pool", bench_raw_allocator, &pool_interface, NULL, raw_operations, {0}},
+            {"load", "add_contact (realloc)", bench_load_legacy, NULL, NULL, load_operations, {0}},
+            {"load", "contact_db (system)", bench_load_db, system_allocator(), NULL, load_operations, {0}},
+            {"load", "contact_db (arena)", bench_load_db, &arena_interface, arena, load_operations, {0}},
+            {"churn", "add/delete_contact", bench_churn_legacy, NULL, NULL, churn_operations, {0}},
+            {"churn", "contact_db (system)", bench_churn_db, system_allocator(), NULL, churn_operations, {0}},
+            {"churn", "contact_db (pool)", bench_churn_db, &pool_interface, NULL, churn_operations, {0}},
+    };
+    const int bench_count = (int) (sizeof(benches) / sizeof(benches[0]));
+
+    // Interleaving the repetitions spreads slow phases of the machine over all benchmarks alike
+    for (int r = 0; r < NUM_OF_REPETITIONS; ++r) {
+        for (int i = 0; i < bench_count; ++i) {
+            benches[i].seconds[r] = benches[i].run(&benches[i]);
+        }
+    }
+    printf("%-6s %-24s %14s %10s %10s\n", "", "", "median ns/op", "min", "max");
+    for (int i = 0; i < bench_count; ++i) {
+        print_result(&benches[i]);
+    }
+
+    arena_destroy(arena);
+    pool_destroy(pool);
+    return 0;
+}
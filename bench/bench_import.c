@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "import_export.h"
+
+#define DEFAULT_NUM_OF_CONTACTS 1000000
+#define BENCH_FILE "bench_import_contacts.tmp"
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static long file_size(const char *file_name) {
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// The database is filled directly, as add_contact checks every name for duplicates and would make it quadratic
+static Contact *generate_contacts(int contact_count) {
+    Contact *database = malloc(sizeof(Contact) * contact_count);
+    if (database == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < contact_count; ++i) {
+        snprintf(database[i].name, sizeof(database[i].name), "Contact Number %d", i);
+        snprintf(database[i].phone, sizeof(database[i].phone), "+370%08d", i % 100000000);
+        snprintf(database[i].email, sizeof(database[i].email), "contact%d@example.com", i);
+    }
+    return database;
+}
+
+static int bench_format(const char *label, ContactFormat format, const Contact *database, int contact_count) {
+    double start = now_seconds();
+    if (export_contacts(database, contact_count, BENCH_FILE, format)) {
+        fprintf(stderr, "Failed to export the contacts as %s\n", label);
+        return 1;
+    }
+    double export_seconds = now_seconds() - start;
+    double megabytes = (double) file_size(BENCH_FILE) / (1024.0 * 1024.0);
+
+    int imported_count = 0;
+    ImportReport report;
+    start = now_seconds();
+    Contact *imported = import_contacts(NULL, &imported_count, BENCH_FILE, format, &report);
+    double import_seconds = now_seconds() - start;
+    free(imported);
+
+    // The same file imported through a handle with a feed, which allocates every contact and publishes an event
+    ChangeFeed *feed = change_feed_create(1 << 16);
+    ContactDB db;
+    contact_db_init(&db, NULL);
+    contact_db_attach_feed(&db, feed);
+    start = now_seconds();
+    ContactStatus db_status = contact_db_import(&db, BENCH_FILE, format, NULL);
+    double db_import_seconds = now_seconds() - start;
+    int db_count = db.count;
+    contact_db_free(&db);
+    change_feed_destroy(feed);
+    remove(BENCH_FILE);
+
+    if (report.error_flag || imported_count != contact_count || db_status != CONTACT_OK || db_count != contact_count) {
+        fprintf(stderr, "Importing the %s file failed, %d and %d of %d contacts imported\n", label, imported_count,
+                db_count, contact_count);
+        return 1;
+    }
+    printf("%-8s %9.1f MB %10.3f s export %10.3f s import %10.0f contacts/s %10.3f s into ContactDB\n",
+           label, megabytes, export_seconds, import_seconds, contact_count / import_seconds, db_import_seconds);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int contact_count = argc > 1 ? atoi(argv[1]) : DEFAULT_NUM_OF_CONTACTS;
+    if (contact_count <= 0) {
+        fprintf(stderr, "Usage: %s [number of contacts]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Contact *database = generate_contacts(contact_count);
+    if (database == NULL) {
+        fprintf(stderr, "Failed to allocate %d contacts\n", contact_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("Importing %d contacts\n", contact_count);
+    int error_flag = bench_format("csv", CONTACT_FORMAT_CSV, database, contact_count) ||
+                     bench_format("vcard4", CONTACT_FORMAT_VCARD4, database, contact_count) ||
+                     bench_format("jsonl", CONTACT_FORMAT_JSONL, database, contact_count);
+
+    free(database);
+    return error_flag ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,278 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "replica.h"
+
+// Every name is added and deleted again right away, so the database stays small and the feed dominates
+#define NUM_OF_NAMES 64
+#define NUM_OF_EVENTS 1000000
+#define JOURNAL_FILE "bench_replication_journal.bin"
+#define SOCKET_FILE "bench_replication.sock"
+#define PACING_BATCH 64
+
+static char names[NUM_OF_NAMES][MAX_NAMELEN + 1];
+
+// When each event was published, indexed by its sequence number
+static long long *publish_ns;
+
+typedef enum {
+    TRANSPORT_MEMORY,
+    TRANSPORT_JOURNAL,
+    TRANSPORT_SOCKET
+} Transport;
+
+typedef struct {
+    ChangeFeed *feed;
+    ContactDB source; // modified by the producer, and copied by the consumer when it lost events
+    Transport transport;
+    long long events_per_second; // 0 publishes as fast as possible
+    atomic_int producer_done_flag;
+} BenchRun;
+
+typedef struct {
+    long long applied;
+    long long lost;
+    long long overruns;
+    long long max_lag_events;
+    double latency_sum_us;
+    double max_latency_us;
+    double catch_up_ms; // from the last publish until the replica applied it, 0 if it never did
+} ConsumerResult;
+
+static long long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// ============
+// = Producer =
+// ============
+
+static void *producer_thread(void *arg) {
+    BenchRun *run = arg;
+
+    // The journal is appended to by the producer itself, the way a primary would persist its feed
+    int journal_fd = -1;
+    ChangeSubscriber journal_subscriber;
+    if (run->transport == TRANSPORT_JOURNAL) {
+        journal_fd = open(JOURNAL_FILE, O_WRONLY | O_APPEND);
+        change_subscriber_init(&journal_subscriber, run->feed, 0);
+    }
+
+    long long start = now_ns();
+    for (long long i = 0; i < NUM_OF_EVENTS; i += 2) {
+        // A paced producer sleeps whenever it gets ahead of its schedule, which also leaves the CPU to the replica
+        if (run->events_per_second > 0 && i % PACING_BATCH == 0) {
+            long long ahead_ns = start + i * 1000000000LL / run->events_per_second - now_ns();
+            if (ahead_ns > 0) {
+                struct timespec pause = {ahead_ns / 1000000000LL, ahead_ns % 1000000000LL};
+                nanosleep(&pause, NULL);
+            }
+        }
+        const char *name = names[(i / 2) % NUM_OF_NAMES];
+        publish_ns[i + 1] = now_ns();
+        contact_db_add(&run->source, name, "+37060000000", "bench@example.com");
+        publish_ns[i + 2] = now_ns();
+        contact_db_delete(&run->source, name);
+        if (journal_fd >= 0 && (i & 255) == 0) {
+            change_stream_pump(&journal_subscriber, journal_fd, NULL);
+        }
+    }
+    if (journal_fd >= 0) {
+        change_stream_pump(&journal_subscriber, journal_fd, NULL);
+        close(journal_fd);
+    }
+
+    atomic_store(&run->producer_done_flag, 1);
+    return NULL;
+}
+
+// ============
+// = Consumer =
+// ============
+
+static void record_event(ConsumerResult *result, const ChangeEvent *event, uint64_t head) {
+    double latency_us = (double) (now_ns() - publish_ns[event->seq]) / 1e3;
+    result->latency_sum_us += latency_us;
+    if (latency_us > result->max_latency_us) {
+        result->max_latency_us = latency_us;
+    }
+    long long lag_events = (long long) (head - event->seq);
+    if (lag_events > result->max_lag_events) {
+        result->max_lag_events = lag_events;
+    }
+}
+
+// Reads the next event over the transport, waiting if there is none yet
+static ChangeFeedStatus next_event(BenchRun *run, ChangeSubscriber *subscriber, ChangeStreamReader *reader,
+                                   ChangeEvent *event) {
+    for (;;) {
+        ChangeFeedStatus status = run->transport == TRANSPORT_MEMORY ? change_subscriber_poll(subscriber, event)
+                                                                     : change_stream_read(reader, event);
+        if (status != CHANGE_FEED_EMPTY) {
+            return status;
+        }
+        if (atomic_load(&run->producer_done_flag) &&
+            change_feed_head(run->feed) == (uint64_t) NUM_OF_EVENTS &&
+            run->transport == TRANSPORT_MEMORY) {
+            return CHANGE_FEED_EMPTY;
+        }
+        sched_yield();
+    }
+}
+
+static ConsumerResult consume(BenchRun *run) {
+    ConsumerResult result = {0};
+    ContactDB replica;
+    contact_db_init(&replica, NULL);
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+
+    ChangeSubscriber subscriber;
+    ChangeStreamReader reader;
+    int fd = -1;
+    if (run->transport == TRANSPORT_MEMORY) {
+        change_subscriber_init(&subscriber, run->feed, 0);
+    } else {
+        fd = run->transport == TRANSPORT_JOURNAL ? open(JOURNAL_FILE, O_RDONLY) : change_feed_connect(SOCKET_FILE, 0, 0);
+        if (fd < 0 || change_stream_reader_init(&reader, fd) != CHANGE_FEED_OK) {
+            fprintf(stderr, "Failed to open the change stream\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t snapshot_from_seq = 0;
+    while (applier.applied_seq < (uint64_t) NUM_OF_EVENTS || applier.snapshot_flag) {
+        ChangeEvent event;
+        ChangeFeedStatus status = next_event(run, &subscriber, &reader, &event);
+        if (status == CHANGE_FEED_OVERRUN) {
+            result.overruns++;
+            if (run->transport == TRANSPORT_JOURNAL) {
+                // The journal ends after an overrun record, so the rest of the events never arrive
+                result.lost += NUM_OF_EVENTS - (long long) applier.applied_seq;
+                break;
+            }
+            // The replica is rebuilt from a copy of the source, made while the producer keeps running
+            uint64_t lost_from_seq = applier.applied_seq;
+            if (replica_resync(&applier, &run->source) != CHANGE_FEED_OK) {
+                fprintf(stderr, "Copying the source failed\n");
+                exit(EXIT_FAILURE);
+            }
+            result.lost += (long long) (applier.applied_seq - lost_from_seq);
+            change_subscriber_init(&subscriber, run->feed, applier.applied_seq);
+            continue;
+        }
+        if (status != CHANGE_FEED_OK) {
+            break;
+        }
+        // The server sends a snapshot instead of the events the socket consumer fell too far behind to get
+        if (event.type == CHANGE_SNAPSHOT_BEGIN) {
+            result.overruns++;
+            snapshot_from_seq = applier.applied_seq;
+        } else if (event.type == CHANGE_SNAPSHOT_END) {
+            result.lost += (long long) (event.seq - snapshot_from_seq);
+        } else if (event.type != CHANGE_SNAPSHOT_CONTACT) {
+            record_event(&result, &event, change_feed_head(run->feed));
+            result.applied++;
+        }
+        if (replica_apply(&applier, &event) != CHANGE_FEED_OK) {
+            fprintf(stderr, "Applying event %llu failed\n", (unsigned long long) event.seq);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (applier.applied_seq == (uint64_t) NUM_OF_EVENTS) {
+        result.catch_up_ms = (double) (now_ns() - publish_ns[NUM_OF_EVENTS]) / 1e6;
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    contact_db_free(&replica);
+    return result;
+}
+
+// =============
+// = Benchmark =
+// =============
+
+static void bench_replication(const char *variant, Transport transport, size_t capacity, long long events_per_second) {
+    BenchRun run;
+    run.feed = change_feed_create(capacity);
+    contact_db_init(&run.source, NULL);
+    contact_db_attach_feed(&run.source, run.feed);
+    run.transport = transport;
+    run.events_per_second = events_per_second;
+    atomic_init(&run.producer_done_flag, 0);
+    if (run.feed == NULL) {
+        fprintf(stderr, "Failed to create the change feed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ChangeFeedServer *server = NULL;
+    if (transport == TRANSPORT_JOURNAL) {
+        close(open(JOURNAL_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    } else if (transport == TRANSPORT_SOCKET && (server = change_feed_serve(&run.source, SOCKET_FILE)) == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    long long start = now_ns();
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, producer_thread, &run) != 0) {
+        fprintf(stderr, "Failed to start the producer\n");
+        exit(EXIT_FAILURE);
+    }
+    ConsumerResult result = consume(&run);
+    pthread_join(producer, NULL);
+    double seconds = (double) (now_ns() - start) / 1e9;
+
+    char rate[24] = "max";
+    if (events_per_second > 0) {
+        snprintf(rate, sizeof(rate), "%lldk", events_per_second / 1000);
+    }
+    printf("%-9s %8zu %6s %10.0f %10.1f %10.1f %10lld %8.2f %9lld %9lld\n",
+           variant, capacity, rate, (double) result.applied / seconds,
+           result.applied > 0 ? result.latency_sum_us / (double) result.applied : 0.0, result.max_latency_us,
+           result.max_lag_events, result.catch_up_ms, result.overruns, result.lost);
+
+    change_feed_server_stop(server);
+    if (transport == TRANSPORT_JOURNAL) {
+        remove(JOURNAL_FILE);
+    }
+    contact_db_free(&run.source);
+    change_feed_destroy(run.feed);
+}
+
+int main(void) {
+    for (int i = 0; i < NUM_OF_NAMES; ++i) {
+        snprintf(names[i], sizeof(names[i]), "%d Bench Contact", i);
+    }
+    publish_ns = malloc(sizeof(long long) * (NUM_OF_EVENTS + 1));
+    if (publish_ns == NULL) {
+        fprintf(stderr, "Failed to allocate the timestamps\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-9s %8s %6s %10s %10s %10s %10s %8s %9s %9s\n", "transport", "ring", "pace", "events/s", "mean us",
+           "max us", "max lag", "tail ms", "overruns", "lost");
+    // Unpaced runs show the peak throughput, paced ones how small a ring can be at a realistic write rate
+    const size_t ring_sizes[] = {1 << 16, 1 << 10, 1 << 6};
+    for (int i = 0; i < 3; ++i) {
+        bench_replication("memory", TRANSPORT_MEMORY, ring_sizes[i], 0);
+        bench_replication("memory", TRANSPORT_MEMORY, ring_sizes[i], 200000);
+    }
+    bench_replication("journal", TRANSPORT_JOURNAL, 1 << 16, 0);
+    bench_replication("journal", TRANSPORT_JOURNAL, 1 << 16, 200000);
+    for (int i = 0; i < 3; ++i) {
+        bench_replication("socket", TRANSPORT_SOCKET, ring_sizes[i], 0);
+        bench_replication("socket", TRANSPORT_SOCKET, ring_sizes[i], 200000);
+    }
+
+    free(publish_ns);
+    return 0;
+}
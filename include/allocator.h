@@ -0,0 +1,112 @@
+#ifndef CONTACT_MANAGEMENT_C_ALLOCATOR_H
+#define CONTACT_MANAGEMENT_C_ALLOCATOR_H
+
+/**
+ * @file allocator.h
+ * @brief Defines the pluggable allocator interface of the contact database, together with the arena and pool allocators.
+ */
+
+#include <stddef.h>
+
+/**
+ * @struct ContactAllocator
+ * @brief A set of memory functions used by the contact database instead of malloc, realloc and free.
+ *
+ * Every function receives the context pointer of the allocator. The sizes of the blocks are passed back
+ * on reallocation and deallocation, so allocators do not have to store them. A function signals
+ * an allocation failure by returning NULL, and the database reports it as an error code.
+ *
+ * @var allocate Allocates a block of the given size.
+ * @var reallocate Resizes a block (or allocates a new one if the pointer is NULL), keeping its contents.
+ * @var deallocate Frees a block of the given size.
+ * @var context Pointer passed as the first argument to every function.
+ */
+typedef struct {
+    void *(*allocate)(void *context, size_t size);
+    void *(*reallocate)(void *context, void *ptr, size_t old_size, size_t new_size);
+    void (*deallocate)(void *context, void *ptr, size_t size);
+    void *context;
+} ContactAllocator;
+
+/**
+ * @brief Returns the allocator backed by malloc, realloc and free.
+ *
+ * @return A pointer to the system allocator.
+ */
+const ContactAllocator *system_allocator(void);
+
+/**
+ * @struct ArenaAllocator
+ * @brief Opaque bump allocator, meant for databases that are loaded once and then only queried.
+ *
+ * Allocations are carved sequentially out of large blocks, and are only released all at once
+ * by arena_reset or arena_destroy. Freeing single blocks is a no-op, except for the most recent allocation.
+ */
+typedef struct ArenaAllocator ArenaAllocator;
+
+/**
+ * @brief Creates an arena.
+ *
+ * @param block_size The size of the blocks requested from the system, larger allocations get a block of their own.
+ * @return A pointer to the new arena, or NULL if it could not be allocated.
+ */
+ArenaAllocator *arena_create(size_t block_size);
+
+/**
+ * @brief Returns the allocator interface of the arena.
+ *
+ * @param arena The arena to allocate from.
+ * @return The allocator, which stays valid until the arena is destroyed.
+ */
+ContactAllocator arena_as_allocator(ArenaAllocator *arena);
+
+/**
+ * @brief Releases every allocation made from the arena, keeping one block for reuse.
+ *
+ * @param arena The arena to reset.
+ */
+void arena_reset(ArenaAllocator *arena);
+
+/**
+ * @brief Frees the arena together with every allocation made from it.
+ *
+ * @param arena The arena to destroy.
+ */
+void arena_destroy(ArenaAllocator *arena);
+
+/**
+ * @struct PoolAllocator
+ * @brief Opaque slab pool, meant for databases with many additions and deletions.
+ *
+ * Blocks up to the slot size are served from slabs of equally sized slots, and freed slots are reused
+ * by later allocations. Larger blocks (like the array of contact pointers) are passed through to malloc.
+ */
+typedef struct PoolAllocator PoolAllocator;
+
+/**
+ * @brief Creates a pool.
+ *
+ * @param slot_size The largest block served from the slabs, usually sizeof(Contact).
+ * @param slots_per_slab The number of slots in every slab requested from the system.
+ * @return A pointer to the new pool, or NULL if it could not be allocated.
+ */
+PoolAllocator *pool_create(size_t slot_size, size_t slots_per_slab);
+
+/**
+ * @brief Returns the allocator interface of the pool.
+ *
+ * @param pool The pool to allocate from.
+ * @return The allocator, which stays valid until the pool is destroyed.
+ */
+ContactAllocator pool_as_allocator(PoolAllocator *pool);
+
+/**
+ * @brief Frees the pool with all of its slabs.
+ *
+ * Blocks passed through to malloc are not tracked, so they have to be freed (e.g. by contact_db_free) beforehand.
+ *
+ * @param pool The pool to destroy.
+ */
+void pool_destroy(PoolAllocator *pool);
+
+#endif //CONTACT_MANAGEMENT_C_ALLOCATOR_H
@@ -0,0 +1,186 @@
+#ifndef CONTACT_MANAGEMENT_C_CHANGE_FEED_H
+#define CONTACT_MANAGEMENT_C_CHANGE_FEED_H
+
+/**
+ * @file change_feed.h
+ * @brief Defines the change feed, which publishes every change of a contact database as a sequence-numbered event.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "contacts.h"
+
+/**
+ * @enum ChangeType
+ * @brief The kind of change an event describes.
+ *
+ * The snapshot kinds are never published to a feed. A feed server sends them to a client that cannot be served
+ * from the ring: a CHANGE_SNAPSHOT_BEGIN, a CHANGE_SNAPSHOT_CONTACT for every contact of the source
+ * and a CHANGE_SNAPSHOT_END, all numbered with the last event the snapshot reflects.
+ */
+typedef enum {
+    CHANGE_ADD = 1,
+    CHANGE_DELETE = 2,
+    CHANGE_SNAPSHOT_BEGIN = 3, // the replica is replaced by the contacts that follow
+    CHANGE_SNAPSHOT_CONTACT = 4, // a contact of the snapshot
+    CHANGE_SNAPSHOT_END = 5 // the snapshot is complete, the events after it follow
+} ChangeType;
+
+/**
+ * @struct ChangeEvent
+ * @brief A single change of the database.
+ *
+ * @var seq The sequence number of the event. The first event has the number 1, and the numbers have no gaps.
+ * @var type The kind of the change.
+ * @var contact The added contact, or the deleted one.
+ */
+typedef struct {
+    uint64_t seq;
+    ChangeType type;
+    Contact contact;
+} ChangeEvent;
+
+/**
+ * @enum ChangeFeedStatus
+ * @brief The result of reading or applying change events.
+ */
+typedef enum {
+    CHANGE_FEED_OK = 0, // an event was read
+    CHANGE_FEED_EMPTY, // there are no new events yet
+    CHANGE_FEED_OVERRUN, // the requested events are no longer available, the reader has to resynchronize
+    CHANGE_FEED_CLOSED, // the other end of the stream was closed
+    CHANGE_FEED_ERROR // an invalid argument, an I/O error, or an event that does not fit the replica
+} ChangeFeedStatus;
+
+/**
+ * @struct ChangeFeed
+ * @brief Opaque lock-free ring buffer of the most recent change events.
+ *
+ * Events are published by a single thread (the one modifying the database), and any number of subscribers
+ * on other threads read them independently, without any locking. Only while a subscriber sleeps
+ * in change_subscriber_wait, the publisher briefly takes a lock to wake it. When the ring is full,
+ * the oldest events are overwritten, and subscribers that did not read them yet get CHANGE_FEED_OVERRUN.
+ *
+ * The feed also carries a reader-writer lock for the database it is attached to (see change_feed_write_lock),
+ * so that the database can be copied on another thread while it is being modified.
+ */
+typedef struct ChangeFeed ChangeFeed;
+
+/**
+ * @struct ChangeSubscriber
+ * @brief The reading position of a single subscriber of the feed.
+ *
+ * @var feed The feed to read from.
+ * @var next_seq The sequence number of the next event to read.
+ */
+typedef struct {
+    const ChangeFeed *feed;
+    uint64_t next_seq;
+} ChangeSubscriber;
+
+/**
+ * @brief Creates a feed.
+ *
+ * @param capacity The number of most recent events kept in the ring, rounded up to a power of two.
+ * @return A pointer to the new feed, or NULL if it could not be allocated.
+ */
+ChangeFeed *change_feed_create(size_t capacity);
+
+/**
+ * @brief Frees the feed. No subscriber may use it afterwards.
+ *
+ * @param feed The feed to destroy.
+ */
+void change_feed_destroy(ChangeFeed *feed);
+
+/**
+ * @brief Locks the database the feed is attached to for a change, which is published before unlocking.
+ *
+ * contact_db_add and contact_db_delete take this lock on their own. Does nothing if the feed is NULL.
+ *
+ * @param feed The feed of the database to lock.
+ */
+void change_feed_write_lock(ChangeFeed *feed);
+
+/**
+ * @brief Locks the database the feed is attached to for reading on another thread than the one modifying it.
+ *
+ * While the lock is held, the database matches the events up to change_feed_head(). contact_db_snapshot takes
+ * this lock on its own. Does nothing if the feed is NULL.
+ *
+ * @param feed The feed of the database to lock.
+ */
+void change_feed_read_lock(const ChangeFeed *feed);
+
+/**
+ * @brief Releases the lock taken by change_feed_write_lock or change_feed_read_lock.
+ *
+ * @param feed The feed of the database to unlock.
+ */
+void change_feed_unlock(const ChangeFeed *feed);
+
+/**
+ * @brief Publishes a new event. Must only be called from one thread at a time.
+ *
+ * @param feed The feed to publish to.
+ * @param type The kind of the change, CHANGE_ADD or CHANGE_DELETE.
+ * @param contact The added or deleted contact.
+ * @return The sequence number of the published event, or 0 if the arguments are invalid.
+ */
+uint64_t change_feed_publish(ChangeFeed *feed, ChangeType type, const Contact *contact);
+
+/**
+ * @brief Returns the random id the feed was created with.
+ *
+ * Every feed numbers its events from 1, so a sequence number only identifies an event together with the id
+ * of its feed, e.g. after the program publishing it restarted with a new feed.
+ *
+ * @param feed The feed to check.
+ * @return The id, which is never 0, or 0 if the feed is NULL.
+ */
+uint64_t change_feed_id(const ChangeFeed *feed);
+
+/**
+ * @brief Returns the sequence number of the most recently published event.
+ *
+ * @param feed The feed to check.
+ * @return The sequence number, or 0 if nothing was published yet.
+ */
+uint64_t change_feed_head(const ChangeFeed *feed);
+
+/**
+ * @brief Starts reading the feed after the given event.
+ *
+ * Passing 0 reads the feed from its first event, passing change_feed_head() reads only new events,
+ * and passing the sequence number of the last processed event resumes a previous subscription.
+ *
+ * @param subscriber The subscriber to initialize.
+ * @param feed The feed to read from.
+ * @param last_seq The sequence number of the last event that was already processed.
+ * @return CHANGE_FEED_OK, or CHANGE_FEED_ERROR if an argument is NULL.
+ */
+ChangeFeedStatus change_subscriber_init(ChangeSubscriber *subscriber, const ChangeFeed *feed, uint64_t last_seq);
+
+/**
+ * @brief Reads the next event, without blocking.
+ *
+ * @param subscriber The subscriber to read with.
+ * @param event Pointer to the event to fill.
+ * @return CHANGE_FEED_OK if an event was read, CHANGE_FEED_EMPTY if there is no new event,
+ *         CHANGE_FEED_OVERRUN if the next event was already overwritten, or CHANGE_FEED_ERROR.
+ */
+ChangeFeedStatus change_subscriber_poll(ChangeSubscriber *subscriber, ChangeEvent *event);
+
+/**
+ * @brief Sleeps until the subscriber has a new event to read, or the timeout passes.
+ *
+ * Lets a subscriber that caught up wait for the publisher instead of polling the feed in a loop.
+ *
+ * @param subscriber The subscriber to wait with.
+ * @param timeout_ms The longest time to wait, in milliseconds.
+ * @return CHANGE_FEED_OK if change_subscriber_poll has something to return (an event or an overrun),
+ *         CHANGE_FEED_EMPTY if the timeout passed first, or CHANGE_FEED_ERROR if an argument is invalid.
+ */
+ChangeFeedStatus change_subscriber_wait(const ChangeSubscriber *subscriber, int timeout_ms);
+
+#endif //CONTACT_MANAGEMENT_C_CHANGE_FEED_H
@@ -0,0 +1,143 @@
+#ifndef CONTACT_MANAGEMENT_C_CHANGE_STREAM_H
+#define CONTACT_MANAGEMENT_C_CHANGE_STREAM_H
+
+/**
+ * @file change_stream.h
+ * @brief Defines how change events are streamed out of process, through a journal file or a Unix socket.
+ *
+ * Events are written as fixed-size binary records of CHANGE_RECORD_SIZE bytes: the sequence number
+ * (8 bytes, little-endian), the change type (1 byte) and the name, phone and email fields padded with zeros.
+ * A record with the type 0 marks that the events starting at its sequence number were lost to an overrun
+ * (only journals contain them, a feed server sends a snapshot instead).
+ * Every stream starts with a header record (type 255, sequence number 0), which carries the id of the feed
+ * (see change_feed_id) as 8 little-endian bytes in place of the name.
+ */
+
+#include <stdint.h>
+#include "change_feed.h"
+#include "contact_db.h"
+
+#define CHANGE_RECORD_SIZE (8 + 1 + (MAX_NAMELEN + 1) + (MAX_PHONELEN + 1) + (MAX_EMAILLEN + 1))
+#define CHANGE_READ_BUFFER_SIZE (64 * CHANGE_RECORD_SIZE)
+
+/**
+ * @struct ChangeStreamReader
+ * @brief Reads change records from a file descriptor, keeping partially received records between calls.
+ *
+ * Records are read in blocks of up to CHANGE_READ_BUFFER_SIZE bytes, so a reader that falls behind
+ * catches up with few system calls.
+ *
+ * @var fd The file descriptor to read from.
+ * @var tail_flag Set for regular files, whose end only means that no more events were written yet.
+ * @var feed_id The id of the feed the events come from, as read from the header of the stream, or 0 before that.
+ * @var buffer The bytes read but not returned as events yet.
+ * @var begin The offset of the next record in the buffer.
+ * @var end The number of bytes in the buffer.
+ */
+typedef struct {
+    int fd;
+    int tail_flag;
+    uint64_t feed_id;
+    unsigned char buffer[CHANGE_READ_BUFFER_SIZE];
+    int begin;
+    int end;
+} ChangeStreamReader;
+
+/**
+ * @struct ChangeFeedServer
+ * @brief Opaque server streaming a database and its feed to the clients of a Unix socket.
+ */
+typedef struct ChangeFeedServer ChangeFeedServer;
+
+/**
+ * @brief Writes every event available to the subscriber to the file descriptor.
+ *
+ * Called periodically with the descriptor of a journal file opened for appending, this keeps the journal
+ * up to date with the feed. On an overrun an overrun record is written, and the subscriber has to be reinitialized.
+ * The header is written when the file is still empty. The journal is searched by sequence number, so a feed
+ * recreated after a restart, which counts from 1 again, has to start a new journal.
+ *
+ * @param subscriber The subscriber to read the events with.
+ * @param fd The file descriptor to write to.
+ * @param written_count Optional pointer to the number of events written.
+ * @return CHANGE_FEED_OK once all available events are written, CHANGE_FEED_OVERRUN, CHANGE_FEED_CLOSED if the
+ *         reading end of a socket or pipe was closed, or CHANGE_FEED_ERROR.
+ */
+ChangeFeedStatus change_stream_pump(ChangeSubscriber *subscriber, int fd, int *written_count);
+
+/**
+ * @brief Initializes a reader of the file descriptor.
+ *
+ * @param reader The reader to initialize.
+ * @param fd The file descriptor to read from, e.g. a journal file or a socket from change_feed_connect.
+ * @return CHANGE_FEED_OK, or CHANGE_FEED_ERROR if the descriptor is invalid.
+ */
+ChangeFeedStatus change_stream_reader_init(ChangeStreamReader *reader, int fd);
+
+/**
+ * @brief Moves the reader of a journal file to the first event after last_seq.
+ *
+ * The journal is searched by sequence number, so the gaps left by overrun records are handled.
+ * The id of the feed is read from the header of the journal.
+ *
+ * @param reader The reader of a regular file.
+ * @param last_seq The sequence number of the last event that was already processed.
+ * @return CHANGE_FEED_OK, CHANGE_FEED_OVERRUN if the event after last_seq is not in the journal
+ *         (it starts later, or the event was lost to an overrun), or CHANGE_FEED_ERROR if the descriptor
+ *         is not a regular file.
+ */
+ChangeFeedStatus change_stream_seek(ChangeStreamReader *reader, uint64_t last_seq);
+
+/**
+ * @brief Reads the next event. Blocks on sockets and pipes until a complete record arrives.
+ *
+ * A header record is not returned, it only sets the feed_id of the reader.
+ *
+ * @param reader The reader to read with.
+ * @param event Pointer to the event to fill.
+ * @return CHANGE_FEED_OK if an event was read, CHANGE_FEED_EMPTY at the current end of a journal file,
+ *         CHANGE_FEED_OVERRUN on an overrun record, CHANGE_FEED_CLOSED if the writer closed the stream,
+ *         or CHANGE_FEED_ERROR on I/O errors and malformed records.
+ */
+ChangeFeedStatus change_stream_read(ChangeStreamReader *reader, ChangeEvent *event);
+
+/**
+ * @brief Starts serving the feed of a database on a Unix socket.
+ *
+ * Every client sends the id of the feed it follows and the sequence number of the last event it processed
+ * (8 bytes each, little-endian) after connecting. It then receives the header of the stream and the events after
+ * that event, until the server is stopped or the client disconnects. When the events after it are no longer
+ * in the ring (the client is new to a feed that already overwrote its first events, or it fell behind),
+ * or the client resumes a different feed (e.g. from before the server restarted), the client receives
+ * a snapshot of the database instead (see ChangeType), followed by the events after it.
+ * Each client is served by a thread of its own.
+ *
+ * The snapshots are copied on the threads of the clients (see contact_db_snapshot), so the database may only be
+ * modified through contact_db_add and contact_db_delete while it is served.
+ *
+ * @param source The database to serve, which must have a feed attached.
+ * @param socket_path The path of the socket. A socket left at the path by a server that is gone (which refuses
+ *                    connections) is replaced, while a socket some server still accepts connections on is not.
+ * @return A pointer to the new server, or NULL if it could not be started or another kind of file exists at the path.
+ */
+ChangeFeedServer *change_feed_serve(const ContactDB *source, const char *socket_path);
+
+/**
+ * @brief Disconnects all clients, stops the server and removes its socket.
+ *
+ * @param server The server to stop.
+ */
+void change_feed_server_stop(ChangeFeedServer *server);
+
+/**
+ * @brief Connects to a feed server, resuming after the given event.
+ *
+ * @param socket_path The path of the server socket.
+ * @param feed_id The id of the feed last_seq belongs to (see ChangeStreamReader), or 0 if last_seq is 0.
+ * @param last_seq The sequence number of the last event that was already processed, 0 to receive all events.
+ * @return The file descriptor of the connection (to be used with a ChangeStreamReader and closed afterwards),
+ *         or -1 on failure.
+ */
+int change_feed_connect(const char *socket_path, uint64_t feed_id, uint64_t last_seq);
+
+#endif //CONTACT_MANAGEMENT_C_CHANGE_STREAM_H
@@ -0,0 +1,166 @@
+#ifndef CONTACT_MANAGEMENT_C_CONTACT_DB_H
+#define CONTACT_MANAGEMENT_C_CONTACT_DB_H
+
+/**
+ * @file contact_db.h
+ * @brief Defines the contact database handle, which takes its memory from a pluggable allocator.
+ */
+
+#include "allocator.h"
+#include "change_feed.h"
+#include "contacts.h"
+
+/**
+ * @enum ContactStatus
+ * @brief The result of an operation on the contact database.
+ */
+typedef enum {
+    CONTACT_OK = 0,
+    CONTACT_ERR_INVALID, // an argument is NULL or a field does not pass validate_info
+    CONTACT_ERR_DUPLICATE, // a contact with the same name is already in the database
+    CONTACT_ERR_NOT_FOUND, // there is no contact with the given name
+    CONTACT_ERR_NO_MEMORY, // the allocator failed, the database is left unchanged
+    CONTACT_ERR_IO // a file could not be opened, read or written
+} ContactStatus;
+
+/**
+ * @struct ContactIndexSlot
+ * @brief A slot of the name index of a contact database.
+ *
+ * @var hash The hash of the name of the contact.
+ * @var contact The contact, or NULL if the slot is empty.
+ */
+typedef struct {
+    uint32_t hash;
+    Contact *contact;
+} ContactIndexSlot;
+
+/**
+ * @struct ContactDB
+ * @brief A contact database, whose memory comes from the allocator it was initialized with.
+ *
+ * Every contact is allocated separately and the database keeps an array of pointers to them,
+ * so adding or deleting a contact never moves the other contacts in memory. The contacts are also indexed by name
+ * in a hash table, so searching, adding and deleting do not scan the whole database.
+ *
+ * @var contacts The contacts of the database, in the order they were added.
+ * @var count The number of contacts in the database.
+ * @var capacity The number of pointers the contacts array has room for.
+ * @var name_index The open addressing hash table of the contacts by name, at most half full, or NULL while empty.
+ * @var index_size The number of slots of the name index, a power of two.
+ * @var allocator The allocator all the memory of the database comes from.
+ * @var feed The feed every successful change is published to, or NULL. Its lock is held during every change.
+ */
+typedef struct {
+    Contact **contacts;
+    int count;
+    int capacity;
+    ContactIndexSlot *name_index;
+    size_t index_size;
+    ContactAllocator allocator;
+    ChangeFeed *feed;
+} ContactDB;
+
+/**
+ * @brief Initializes an empty database.
+ *
+ * @param db The database to initialize.
+ * @param allocator The allocator to take the memory from, or NULL for the system allocator. It is copied into the database.
+ * @return CONTACT_OK, or CONTACT_ERR_INVALID if db is NULL.
+ */
+ContactStatus contact_db_init(ContactDB *db, const ContactAllocator *allocator);
+
+/**
+ * @brief Attaches a change feed, which receives an event for every contact added or deleted from now on.
+ *
+ * The database does not own the feed. Contacts freed by contact_db_free are not published as deletions.
+ *
+ * @param db The database to attach the feed to.
+ * @param feed The feed to publish to, or NULL to detach the current one.
+ */
+void contact_db_attach_feed(ContactDB *db, ChangeFeed *feed);
+
+/**
+ * @brief Frees all contacts of the database, leaving it empty (but still usable).
+ *
+ * @param db The database to free.
+ */
+void contact_db_free(ContactDB *db);
+
+/**
+ * @brief Adds a new contact to the database.
+ *
+ * @param db The database to add to.
+ * @param name The name of the contact.
+ * @param phone The phone number of the contact.
+ * @param email The email address of the contact.
+ * @return CONTACT_OK on success, otherwise the reason why the contact was not added.
+ */
+ContactStatus contact_db_add(ContactDB *db, const char *name, const char *phone, const char *email);
+
+/**
+ * @brief Searches for a contact by name.
+ *
+ * @param db The database to search in.
+ * @param name The name of the contact to search for.
+ * @return A pointer to the found contact, or NULL if not found.
+ */
+Contact *contact_db_search(const ContactDB *db, const char *name);
+
+/**
+ * @brief Deletes a contact by name.
+ *
+ * @param db The database to delete from.
+ * @param name The name of the contact to delete.
+ * @return CONTACT_OK on success, otherwise the reason why no contact was deleted.
+ */
+ContactStatus contact_db_delete(ContactDB *db, const char *name);
+
+/**
+ * @brief Replaces the contents of a database with a copy of another one, e.g. to bootstrap a replica.
+ *
+ * The copy takes its memory from its own allocator and keeps its own feed, to which the copied contacts are not
+ * published. A source with a feed may be modified on another thread during the call: the changes wait for the copy
+ * to finish (see change_feed_read_lock), so the copy matches the returned sequence number. A source without a feed
+ * must not be modified during the call.
+ *
+ * @param source The database to copy.
+ * @param copy The initialized database to replace the contents of.
+ * @param head_seq Optional pointer to the sequence number of the last event published by the feed of the source
+ *                 (0 without a feed), i.e. the event the copy reflects.
+ * @return CONTACT_OK, CONTACT_ERR_INVALID, or CONTACT_ERR_NO_MEMORY (the copy is then left unchanged).
+ */
+ContactStatus contact_db_snapshot(const ContactDB *source, ContactDB *copy, uint64_t *head_seq);
+
+/**
+ * @brief Loads the contacts saved by save_contacts_to_file into the database.
+ *
+ * The file is parsed straight into the database, every contact being added by contact_db_add (and so published
+ * to the attached feed). A missing file is loaded as an empty one.
+ *
+ * @param db The database to add the contacts to.
+ * @param input_file The file to load the contacts from.
+ * @return CONTACT_OK, CONTACT_ERR_IO if the file could not be opened or read, CONTACT_ERR_INVALID if a line is too
+ *         long or the last contact is incomplete, or the reason why a loaded contact could not be added.
+ *         The contacts loaded before the failure are kept.
+ */
+ContactStatus contact_db_load_from_file(ContactDB *db, const char *input_file);
+
+/**
+ * @brief Saves the contacts in the format of save_contacts_to_file.
+ *
+ * @param db The database to save.
+ * @param output_file The file to save the contacts to.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
+ */
+int contact_db_save_to_file(const ContactDB *db, const char *output_file);
+
+/**
+ * @brief Returns a human-readable description of a status.
+ *
+ * @param status The status to describe.
+ * @return A static string describing the status.
+ */
+const char *contact_status_message(ContactStatus status);
+
+#endif //CONTACT_MANAGEMENT_C_CONTACT_DB_H
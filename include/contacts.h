@@ -24,6 +24,17 @@ typedef struct {
     char email[MAX_EMAILLEN+1];
 } Contact;
 
+/**
+ * @brief Validates a single field of a contact.
+ *
+ * The data is valid if it is not empty, not longer than maxlen and does not contain newlines.
+ *
+ * @param data The field to validate.
+ * @param maxlen The maximum number of characters allowed for the field.
+ * @return 0 if the data is valid, 1 otherwise.
+ */
+int validate_info(const char *data, int maxlen);
+
 /**
  * @brief Adds a new contact to the database.
  *
@@ -32,7 +43,8 @@ typedef struct {
  * @param email The email address of the contact.
  * @param database The current contact database.
  * @param contact_count Pointer to the number of contacts in the database.
- * @return A pointer to the updated contact database.
+ * @return A pointer to the updated contact database, or NULL if the contact is invalid, already exists,
+ *         or memory could not be allocated (in which case the original database is left unchanged).
  */
 Contact *add_contact(const char *name, const char *phone, const char *email, Contact *database, int *contact_count);
 
@@ -70,8 +82,9 @@ void list_contacts(const Contact *database, int contact_count);
  * @param database The current contact database.
  * @param contact_count The number of contacts in the database.
  * @param output_file The file to save the contacts to.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
  */
-void save_contacts_to_file(Contact *database, int contact_count, const char *output_file);
+int save_contacts_to_file(Contact *database, int contact_count, const char *output_file);
 
 /**
  * @brief Loads contacts from a file.
@@ -0,0 +1,148 @@
+#ifndef CONTACT_MANAGEMENT_C_IMPORT_EXPORT_H
+#define CONTACT_MANAGEMENT_C_IMPORT_EXPORT_H
+
+/**
+ * @file import_export.h
+ * @brief Defines the streaming importers and exporters for the CSV, vCard and JSON Lines formats.
+ */
+
+#include <stdio.h>
+#include "contact_db.h"
+#include "contacts.h"
+
+/**
+ * @enum ContactFormat
+ * @brief The interchange formats supported for bulk import and export.
+ *
+ * Both vCard values are accepted by the importer, which reads 3.0 and 4.0 cards alike.
+ * For the exporter they select the version of the written cards.
+ */
+typedef enum {
+    CONTACT_FORMAT_CSV,
+    CONTACT_FORMAT_VCARD3,
+    CONTACT_FORMAT_VCARD4,
+    CONTACT_FORMAT_JSONL
+} ContactFormat;
+
+/**
+ * @struct ImportReport
+ * @brief Summarizes the outcome of an import.
+ *
+ * @var imported The number of contacts added to the database.
+ * @var skipped The number of records rejected because of invalid or duplicate data.
+ * @var first_error_line The line on which the first rejected record starts, or 0 if nothing was rejected.
+ * @var error_flag Set if the input could not be read to the end (I/O error or out of memory).
+ */
+typedef struct {
+    int imported;
+    int skipped;
+    long first_error_line;
+    int error_flag;
+} ImportReport;
+
+/**
+ * @brief Imports contacts from a file in the given format.
+ *
+ * The file is read in large chunks and parsed in place. Every record is validated with the same limits
+ * as add_contact, and a record that fails validation (or whose name is already in the database) is reported
+ * on stderr together with its line number and skipped, while the rest of the file is still imported.
+ * The database grows geometrically, so the import does not reallocate it for every record.
+ *
+ * @param database The current contact database.
+ * @param contact_count Pointer to the number of contacts in the database.
+ * @param input_file The file to import the contacts from.
+ * @param format The format of the file.
+ * @param report Optional pointer to a report, which is filled with the outcome of the import.
+ * @return A pointer to the updated contact database.
+ */
+Contact *import_contacts(Contact *database, int *contact_count, const char *input_file, ContactFormat format,
+                         ImportReport *report);
+
+/**
+ * @brief Imports contacts from an already opened stream, see import_contacts.
+ *
+ * @param database The current contact database.
+ * @param contact_count Pointer to the number of contacts in the database.
+ * @param input The stream to import the contacts from.
+ * @param source_name The name of the stream, used as a prefix of the error messages.
+ * @param format The format of the stream.
+ * @param report Optional pointer to a report, which is filled with the outcome of the import.
+ * @return A pointer to the updated contact database.
+ */
+Contact *import_contacts_from_stream(Contact *database, int *contact_count, FILE *input, const char *source_name,
+                                     ContactFormat format, ImportReport *report);
+
+/**
+ * @brief Exports the contacts to a file in the given format.
+ *
+ * @param database The current contact database.
+ * @param contact_count The number of contacts in the database.
+ * @param output_file The file to export the contacts to.
+ * @param format The format of the file.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
+ */
+int export_contacts(const Contact *database, int contact_count, const char *output_file, ContactFormat format);
+
+/**
+ * @brief Exports the contacts to an already opened stream, see export_contacts.
+ *
+ * @param database The current contact database.
+ * @param contact_count The number of contacts in the database.
+ * @param output The stream to export the contacts to.
+ * @param format The format of the stream.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
+ */
+int export_contacts_to_stream(const Contact *database, int contact_count, FILE *output, ContactFormat format);
+
+/**
+ * @brief Imports contacts from a file into a contact database handle.
+ *
+ * The file is parsed and validated like in import_contacts, and every accepted record is added with contact_db_add.
+ * So the name index of the handle rejects duplicate names, its contacts array grows geometrically,
+ * and every imported contact is published to its feed as an event of its own.
+ *
+ * @param db The database to import the contacts into.
+ * @param input_file The file to import the contacts from.
+ * @param format The format of the file.
+ * @param report Optional pointer to a report, which is filled with the outcome of the import.
+ * @return CONTACT_OK if the whole file was processed (even if some records were skipped), CONTACT_ERR_INVALID
+ *         if an argument is invalid, CONTACT_ERR_IO if the file could not be opened or read to the end,
+ *         or CONTACT_ERR_NO_MEMORY if the allocator of the database failed. The contacts imported before
+ *         an error are kept.
+ */
+ContactStatus contact_db_import(ContactDB *db, const char *input_file, ContactFormat format, ImportReport *report);
+
+/**
+ * @brief Imports contacts from an already opened stream into a contact database handle, see contact_db_import.
+ *
+ * @param db The database to import the contacts into.
+ * @param input The stream to import the contacts from.
+ * @param source_name The name of the stream, used as a prefix of the error messages.
+ * @param format The format of the stream.
+ * @param report Optional pointer to a report, which is filled with the outcome of the import.
+ * @return The same statuses as contact_db_import.
+ */
+ContactStatus contact_db_import_from_stream(ContactDB *db, FILE *input, const char *source_name, ContactFormat format,
+                                            ImportReport *report);
+
+/**
+ * @brief Exports the contacts of a contact database handle to a file in the given format.
+ *
+ * @param db The database to export.
+ * @param output_file The file to export the contacts to.
+ * @param format The format of the file.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
+ */
+int contact_db_export(const ContactDB *db, const char *output_file, ContactFormat format);
+
+/**
+ * @brief Exports the contacts of a contact database handle to an already opened stream, see contact_db_export.
+ *
+ * @param db The database to export.
+ * @param output The stream to export the contacts to.
+ * @param format The format of the stream.
+ * @return 0 if all contacts were written successfully, 1 otherwise.
+ */
+int contact_db_export_to_stream(const ContactDB *db, FILE *output, ContactFormat format);
+
+#endif //CONTACT_MANAGEMENT_C_IMPORT_EXPORT_H
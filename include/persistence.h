@@ -0,0 +1,78 @@
+#ifndef CONTACT_MANAGEMENT_C_PERSISTENCE_H
+#define CONTACT_MANAGEMENT_C_PERSISTENCE_H
+
+/**
+ * @file persistence.h
+ * @brief Defines the background persister, which saves snapshots of the contact database on a dedicated I/O thread.
+ */
+
+#include "contact_db.h"
+#include "contacts.h"
+
+/**
+ * @struct Persister
+ * @brief Opaque handle of a background persistence thread bound to a single output file.
+ *
+ * Callers hand over snapshots with persister_submit(), which only copies the contacts into memory
+ * owned by the persister. The file itself is rewritten on the I/O thread, so the caller never waits for the disk.
+ */
+typedef struct Persister Persister;
+
+/**
+ * @brief Starts a persistence thread for the given file.
+ *
+ * A submitted snapshot is written at most autosave_interval_ms milliseconds after the first unsaved submission,
+ * which bounds how many edits can be lost in a crash. With an interval of 0 every submission is written right away.
+ * A snapshot that fails to save (e.g. on a full disk) stays pending and is retried after another interval.
+ * The file is replaced atomically (written to a temporary file, synced and renamed, then the directory is synced),
+ * so a crash during a save leaves the previous version intact, and a finished save survives a crash.
+ *
+ * @param output_file The file to save the contacts to.
+ * @param autosave_interval_ms The maximum delay between a submission and its save, in milliseconds.
+ * @return A pointer to the new persister, or NULL if it could not be started.
+ */
+Persister *persister_start(const char *output_file, int autosave_interval_ms);
+
+/**
+ * @brief Hands over a snapshot of the database to be saved in the background.
+ *
+ * The contacts are copied, so the caller is free to modify or free the database right after the call.
+ * Snapshots that were not written yet are replaced by the newer one.
+ *
+ * @param persister The persister to submit to.
+ * @param database The current contact database.
+ * @param contact_count The number of contacts in the database.
+ * @return 0 if the snapshot was accepted, 1 otherwise (invalid arguments or out of memory).
+ */
+int persister_submit(Persister *persister, const Contact *database, int contact_count);
+
+/**
+ * @brief Hands over a snapshot of a database handle to be saved in the background, see persister_submit.
+ *
+ * @param persister The persister to submit to.
+ * @param db The database to save.
+ * @return 0 if the snapshot was accepted, 1 otherwise (invalid arguments or out of memory).
+ */
+int persister_submit_db(Persister *persister, const ContactDB *db);
+
+/**
+ * @brief Waits until a save was attempted for every snapshot submitted so far.
+ *
+ * A snapshot whose earlier save failed is saved again right away, instead of after the interval.
+ *
+ * @param persister The persister to flush.
+ * @return 0 if the latest save succeeded, 1 otherwise (the snapshot is then retried in the background).
+ */
+int persister_flush(Persister *persister);
+
+/**
+ * @brief Flushes the pending snapshot, stops the thread and frees the persister.
+ *
+ * The pending snapshot is written once more even if its earlier saves failed, but not retried after that.
+ *
+ * @param persister The persister to stop.
+ * @return 0 if the final save succeeded, 1 otherwise (the unsaved edits are lost).
+ */
+int persister_stop(Persister *persister);
+
+#endif //CONTACT_MANAGEMENT_C_PERSISTENCE_H
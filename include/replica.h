@@ -0,0 +1,104 @@
+#ifndef CONTACT_MANAGEMENT_C_REPLICA_H
+#define CONTACT_MANAGEMENT_C_REPLICA_H
+
+/**
+ * @file replica.h
+ * @brief Defines the replica applier, which keeps a copy of a contact database in sync by applying its change events.
+ */
+
+#include <stdint.h>
+#include "change_stream.h"
+#include "contact_db.h"
+
+/**
+ * @struct ReplicaApplier
+ * @brief Applies change events to a replica database, in order and exactly once.
+ *
+ * @var replica The database the events are applied to.
+ * @var applied_seq The sequence number of the last applied event, to resume the feed after.
+ * @var feed_id The id of the feed applied_seq belongs to (see change_feed_id), or 0 until the first feed is seen.
+ *              Events of another feed are reported as lost, since their sequence numbers do not match.
+ * @var snapshot_flag Set while a snapshot sent by a feed server is applied, the replica is incomplete until its end.
+ * @var source The database the replica is copied from when events were lost, or NULL.
+ */
+typedef struct {
+    ContactDB *replica;
+    uint64_t applied_seq;
+    uint64_t feed_id;
+    int snapshot_flag;
+    const ContactDB *source;
+} ReplicaApplier;
+
+/**
+ * @brief Initializes an applier.
+ *
+ * @param applier The applier to initialize.
+ * @param replica The database to apply the events to. It must match the source database as of applied_seq.
+ * @param applied_seq The sequence number of the last event already reflected in the replica, 0 for an empty one.
+ * @return CHANGE_FEED_OK, or CHANGE_FEED_ERROR if an argument is NULL.
+ */
+ChangeFeedStatus replica_applier_init(ReplicaApplier *applier, ContactDB *replica, uint64_t applied_seq);
+
+/**
+ * @brief Sets the database to resynchronize from, when the catch-up functions find that events were lost.
+ *
+ * The source is copied on the thread calling the catch-up functions. It may be modified on another thread
+ * meanwhile, since contact_db_snapshot locks out its changes through its feed while copying it.
+ *
+ * @param applier The applier to set the source of.
+ * @param source The database the events come from, or NULL to report lost events instead.
+ */
+void replica_applier_set_source(ReplicaApplier *applier, const ContactDB *source);
+
+/**
+ * @brief Replaces the replica with a snapshot of the source, and continues after the last event the source published.
+ *
+ * @param applier The applier to resynchronize.
+ * @param source The database to copy (see contact_db_snapshot).
+ * @return CHANGE_FEED_OK, or CHANGE_FEED_ERROR if an argument is NULL or the copy could not be allocated.
+ */
+ChangeFeedStatus replica_resync(ReplicaApplier *applier, const ContactDB *source);
+
+/**
+ * @brief Applies a single event.
+ *
+ * Events that were already applied are ignored, so a stream can be safely resumed from an earlier position.
+ * The records of a snapshot (see ChangeType) replace the contents of the replica, and the events after the
+ * snapshot are applied to it.
+ *
+ * @param applier The applier to use.
+ * @param event The event to apply.
+ * @return CHANGE_FEED_OK if the event was applied or ignored, CHANGE_FEED_OVERRUN if events before it are missing,
+ *         or CHANGE_FEED_ERROR if the event does not fit the replica (e.g. deleting a contact it does not have,
+ *         or an event in the middle of a snapshot).
+ */
+ChangeFeedStatus replica_apply(ReplicaApplier *applier, const ChangeEvent *event);
+
+/**
+ * @brief Applies all events currently available to an in-process subscriber.
+ *
+ * If events were lost and the applier has a source, the replica is resynchronized from it
+ * and the subscriber continues after the snapshot.
+ *
+ * @param applier The applier to use.
+ * @param subscriber The subscriber to read the events with.
+ * @return CHANGE_FEED_EMPTY once the replica caught up, otherwise the status that stopped it.
+ */
+ChangeFeedStatus replica_catch_up(ReplicaApplier *applier, ChangeSubscriber *subscriber);
+
+/**
+ * @brief Applies events read from a journal file or a feed server connection.
+ *
+ * On a socket this blocks until the server closes the connection, on a journal file it returns at its current end.
+ * A feed server sends a snapshot instead of the events a client can no longer get, which replaces the replica.
+ * A snapshot cut off by the end of the connection leaves the replica empty, and the client then reconnects
+ * with feed_id and applied_seq (0) to get a new one. If events were lost from a journal and the applier
+ * has a source, the replica is resynchronized from it, and the events up to the copy are skipped.
+ *
+ * @param applier The applier to use.
+ * @param reader The reader to read the events with.
+ * @return CHANGE_FEED_EMPTY at the end of a journal file, otherwise the status that stopped it.
+ */
+ChangeFeedStatus replica_catch_up_stream(ReplicaApplier *applier, ChangeStreamReader *reader);
+
+#endif //CONTACT_MANAGEMENT_C_REPLICA_H
@@ -0,0 +1,315 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+// Every block handed out is aligned like malloc would align it
+#define ALLOCATION_ALIGNMENT 16
+#define ALIGN_UP(size) (((size) + ALLOCATION_ALIGNMENT - 1) & ~((size_t) ALLOCATION_ALIGNMENT - 1))
+
+// ====================
+// = System allocator =
+// ====================
+
+static void *system_allocate(void *context, size_t size) {
+    (void) context;
+    return malloc(size);
+}
+
+static void *system_reallocate(void *context, void *ptr, size_t old_size, size_t new_size) {
+    (void) context;
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+static void system_deallocate(void *context, void *ptr, size_t size) {
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+static const ContactAllocator system_allocator_instance = {
+        system_allocate,
+        system_reallocate,
+        system_deallocate,
+        NULL
+};
+
+const ContactAllocator *system_allocator(void) {
+    return &system_allocator_instance;
+}
+
+// ===================
+// = Arena allocator =
+// ===================
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t capacity;
+    size_t used;
+} ArenaBlock;
+
+#define ARENA_HEADER_SIZE ALIGN_UP(sizeof(ArenaBlock))
+// Larger sizes would wrap around when aligned or when the block header is added
+#define ARENA_MAX_ALLOCATION (SIZE_MAX - ALLOCATION_ALIGNMENT - ARENA_HEADER_SIZE)
+
+struct ArenaAllocator {
+    ArenaBlock *blocks; // the block currently allocated from is the first one
+    size_t block_size;
+    char *last_allocation; // can be resized or freed in place
+};
+
+static char *block_data(ArenaBlock *block) {
+    return (char *) block + ARENA_HEADER_SIZE;
+}
+
+ArenaAllocator *arena_create(size_t block_size) {
+    if (block_size > ARENA_MAX_ALLOCATION) {
+        return NULL;
+    }
+    ArenaAllocator *arena = malloc(sizeof(ArenaAllocator));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->blocks = NULL;
+    arena->block_size = block_size > 0 ? ALIGN_UP(block_size) : 1 << 16;
+    arena->last_allocation = NULL;
+    return arena;
+}
+
+static void *arena_allocate(void *context, size_t size) {
+    ArenaAllocator *arena = context;
+    if (size > ARENA_MAX_ALLOCATION) {
+        return NULL;
+    }
+    size = ALIGN_UP(size > 0 ? size : 1);
+
+    ArenaBlock *block = arena->blocks;
+    if (block == NULL || block->capacity - block->used < size) {
+        size_t capacity = size > arena->block_size ? size : arena->block_size;
+        ArenaBlock *new_block = malloc(ARENA_HEADER_SIZE + capacity);
+        if (new_block == NULL) {
+            return NULL;
+        }
+        new_block->capacity = capacity;
+        new_block->used = 0;
+
+        // A block of its own for an oversized allocation goes behind the current block,
+        // so the space left in the current one is not wasted
+        if (block != NULL && size > arena->block_size && block->capacity - block->used >= ALLOCATION_ALIGNMENT) {
+            new_block->next = block->next;
+            block->next = new_block;
+            new_block->used = size;
+            arena->last_allocation = NULL;
+            return block_data(new_block);
+        }
+        new_block->next = block;
+        arena->blocks = new_block;
+        block = new_block;
+    }
+
+    char *ptr = block_data(block) + block->used;
+    block->used += size;
+    arena->last_allocation = ptr;
+    return ptr;
+}
+
+static void *arena_reallocate(void *context, void *ptr, size_t old_size, size_t new_size) {
+    ArenaAllocator *arena = context;
+    if (new_size > ARENA_MAX_ALLOCATION) {
+        return NULL;
+    }
+    if (ptr == NULL) {
+        return arena_allocate(context, new_size);
+    }
+
+    // The most recent allocation can simply be extended or shrunk
+    ArenaBlock *block = arena->blocks;
+    if (ptr == arena->last_allocation) {
+        size_t offset = (size_t) ((char *) ptr - block_data(block));
+        if (ALIGN_UP(new_size) <= block->capacity - offset) {
+            block->used = offset + ALIGN_UP(new_size > 0 ? new_size : 1);
+            return ptr;
+        }
+    } else if (new_size <= old_size) {
+        return ptr;
+    }
+
+    void *new_ptr = arena_allocate(context, new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    return new_ptr;
+}
+
+static void arena_deallocate(void *context, void *ptr, size_t size) {
+    (void) size;
+    ArenaAllocator *arena = context;
+    if (ptr != NULL && ptr == arena->last_allocation) {
+        arena->blocks->used = (size_t) ((char *) ptr - block_data(arena->blocks));
+        arena->last_allocation = NULL;
+    }
+}
+
+ContactAllocator arena_as_allocator(ArenaAllocator *arena) {
+    ContactAllocator allocator = {arena_allocate, arena_reallocate, arena_deallocate, arena};
+    return allocator;
+}
+
+void arena_reset(ArenaAllocator *arena) {
+    if (arena == NULL || arena->blocks == NULL) {
+        return;
+    }
+
+    // Keep the current block, it has the regular size unless the arena was used only for oversized allocations
+    ArenaBlock *block = arena->blocks->next;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+    arena->last_allocation = NULL;
+}
+
+void arena_destroy(ArenaAllocator *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    ArenaBlock *block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// ==================
+// = Pool allocator =
+// ==================
+
+typedef struct PoolSlab {
+    struct PoolSlab *next;
+} PoolSlab;
+
+#define POOL_HEADER_SIZE ALIGN_UP(sizeof(PoolSlab))
+
+// Free slots are linked through their own memory
+typedef struct PoolSlot {
+    struct PoolSlot *next;
+} PoolSlot;
+
+struct PoolAllocator {
+    size_t slot_size;
+    size_t slots_per_slab;
+    PoolSlab *slabs;
+    PoolSlot *free_slots;
+};
+
+PoolAllocator *pool_create(size_t slot_size, size_t slots_per_slab) {
+    if (slot_size == 0 || slots_per_slab == 0 || slot_size > SIZE_MAX / 2 / slots_per_slab) {
+        return NULL;
+    }
+
+    PoolAllocator *pool = malloc(sizeof(PoolAllocator));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->slot_size = ALIGN_UP(slot_size < sizeof(PoolSlot) ? sizeof(PoolSlot) : slot_size);
+    pool->slots_per_slab = slots_per_slab;
+    pool->slabs = NULL;
+    pool->free_slots = NULL;
+    return pool;
+}
+
+static int pool_add_slab(PoolAllocator *pool) {
+    PoolSlab *slab = malloc(POOL_HEADER_SIZE + pool->slot_size * pool->slots_per_slab);
+    if (slab == NULL) {
+        return 1;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    // Thread the slots in reverse, so that they are handed out in address order
+    char *slots = (char *) slab + POOL_HEADER_SIZE;
+    for (size_t i = pool->slots_per_slab; i > 0; --i) {
+        PoolSlot *slot = (PoolSlot *) (slots + (i - 1) * pool->slot_size);
+        slot->next = pool->free_slots;
+        pool->free_slots = slot;
+    }
+    return 0;
+}
+
+static void *pool_allocate(void *context, size_t size) {
+    PoolAllocator *pool = context;
+    if (size > pool->slot_size) {
+        return malloc(size);
+    }
+
+    if (pool->free_slots == NULL && pool_add_slab(pool)) {
+        return NULL;
+    }
+    PoolSlot *slot = pool->free_slots;
+    pool->free_slots = slot->next;
+    return slot;
+}
+
+static void pool_deallocate(void *context, void *ptr, size_t size) {
+    PoolAllocator *pool = context;
+    if (ptr == NULL) {
+        return;
+    }
+    if (size > pool->slot_size) {
+        free(ptr);
+        return;
+    }
+
+    PoolSlot *slot = ptr;
+    slot->next = pool->free_slots;
+    pool->free_slots = slot;
+}
+
+static void *pool_reallocate(void *context, void *ptr, size_t old_size, size_t new_size) {
+    PoolAllocator *pool = context;
+    if (ptr == NULL) {
+        return pool_allocate(context, new_size);
+    }
+    if (old_size > pool->slot_size && new_size > pool->slot_size) {
+        return realloc(ptr, new_size);
+    }
+    if (old_size <= pool->slot_size && new_size <= pool->slot_size) {
+        return ptr;
+    }
+
+    // The block moves between a slot and malloc
+    void *new_ptr = pool_allocate(context, new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    pool_deallocate(context, ptr, old_size);
+    return new_ptr;
+}
+
+ContactAllocator pool_as_allocator(PoolAllocator *pool) {
+    ContactAllocator allocator = {pool_allocate, pool_reallocate, pool_deallocate, pool};
+    return allocator;
+}
+
+void pool_destroy(PoolAllocator *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    PoolSlab *slab = pool->slabs;
+    while (slab != NULL) {
+        PoolSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(pool);
+}
@@ -0,0 +1,243 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include "change_feed.h"
+
+#define SLOT_WORD_COUNT ((sizeof(ChangeEvent) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+// Every slot works like a seqlock: the publisher clears the sequence number before rewriting the event,
+// and stores the new one afterwards, so a reader detects a slot that was overwritten while it was copied.
+// The event is stored as relaxed atomic words, so that copying a slot while it is rewritten is not a data race
+typedef struct {
+    _Atomic uint64_t seq; // 0 while the slot is empty or being written
+    _Atomic uint64_t event_words[SLOT_WORD_COUNT];
+} FeedSlot;
+
+struct ChangeFeed {
+    uint64_t id;
+    FeedSlot *slots;
+    size_t mask;
+    _Atomic uint64_t head;
+    // Subscribers sleeping in change_subscriber_wait, the publisher only locks the mutex to wake them while any wait
+    atomic_int waiter_count;
+    pthread_mutex_t wait_mutex;
+    pthread_cond_t wait_cond;
+    // Held for writing while the database the feed is attached to changes, so that it can be copied on other threads
+    pthread_rwlock_t database_lock;
+};
+
+// Draws the id of a new feed, which is never 0
+static uint64_t random_feed_id(void) {
+    uint64_t id = 0;
+    if (getrandom(&id, sizeof(id), GRND_NONBLOCK) != (ssize_t) sizeof(id)) {
+        // Without the kernel's randomness, the clock and the address of the stack still tell two runs apart
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        id = ((uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec) ^ ((uint64_t) (uintptr_t) &id << 16);
+        id *= 0x9E3779B97F4A7C15ULL;
+    }
+    return id != 0 ? id : 1;
+}
+
+ChangeFeed *change_feed_create(size_t capacity) {
+    if (capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(FeedSlot)) {
+        return NULL;
+    }
+    size_t slot_count = 1;
+    while (slot_count < capacity) {
+        slot_count *= 2;
+    }
+
+    ChangeFeed *feed = malloc(sizeof(ChangeFeed));
+    if (feed == NULL) {
+        return NULL;
+    }
+    feed->slots = malloc(sizeof(FeedSlot) * slot_count);
+    if (feed->slots == NULL) {
+        free(feed);
+        return NULL;
+    }
+    // The waiting subscribers measure their timeout on the monotonic clock, so that it is not affected by clock changes
+    pthread_condattr_t cond_attr;
+    int error_flag = pthread_condattr_init(&cond_attr) != 0;
+    if (!error_flag) {
+        error_flag = pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC) != 0 ||
+                     pthread_cond_init(&feed->wait_cond, &cond_attr) != 0;
+        pthread_condattr_destroy(&cond_attr);
+    }
+    if (error_flag || pthread_mutex_init(&feed->wait_mutex, NULL) != 0) {
+        if (!error_flag) {
+            pthread_cond_destroy(&feed->wait_cond);
+        }
+        free(feed->slots);
+        free(feed);
+        return NULL;
+    }
+    if (pthread_rwlock_init(&feed->database_lock, NULL) != 0) {
+        pthread_cond_destroy(&feed->wait_cond);
+        pthread_mutex_destroy(&feed->wait_mutex);
+        free(feed->slots);
+        free(feed);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < slot_count; ++i) {
+        atomic_init(&feed->slots[i].seq, 0);
+    }
+    feed->id = random_feed_id();
+    feed->mask = slot_count - 1;
+    atomic_init(&feed->head, 0);
+    atomic_init(&feed->waiter_count, 0);
+    return feed;
+}
+
+void change_feed_destroy(ChangeFeed *feed) {
+    if (feed == NULL) {
+        return;
+    }
+    pthread_cond_destroy(&feed->wait_cond);
+    pthread_mutex_destroy(&feed->wait_mutex);
+    pthread_rwlock_destroy(&feed->database_lock);
+    free(feed->slots);
+    free(feed);
+}
+
+void change_feed_write_lock(ChangeFeed *feed) {
+    if (feed != NULL) {
+        pthread_rwlock_wrlock(&feed->database_lock);
+    }
+}
+
+void change_feed_read_lock(const ChangeFeed *feed) {
+    if (feed != NULL) {
+        pthread_rwlock_rdlock(&((ChangeFeed *) feed)->database_lock);
+    }
+}
+
+void change_feed_unlock(const ChangeFeed *feed) {
+    if (feed != NULL) {
+        pthread_rwlock_unlock(&((ChangeFeed *) feed)->database_lock);
+    }
+}
+
+uint64_t change_feed_publish(ChangeFeed *feed, ChangeType type, const Contact *contact) {
+    if (feed == NULL || contact == NULL || (type != CHANGE_ADD && type != CHANGE_DELETE)) {
+        return 0;
+    }
+
+    // Only the publishing thread writes the head, so it can be read without synchronization
+    uint64_t seq = atomic_load_explicit(&feed->head, memory_order_relaxed) + 1;
+    FeedSlot *slot = &feed->slots[seq & feed->mask];
+
+    ChangeEvent event;
+    memset(&event, 0, sizeof(ChangeEvent));
+    event.seq = seq;
+    event.type = type;
+    event.contact = *contact;
+    uint64_t event_words[SLOT_WORD_COUNT] = {0};
+    memcpy(event_words, &event, sizeof(ChangeEvent));
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < SLOT_WORD_COUNT; ++i) {
+        atomic_store_explicit(&slot->event_words[i], event_words[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->seq, seq, memory_order_release);
+    atomic_store_explicit(&feed->head, seq, memory_order_release);
+
+    // Pairs with the fence in change_subscriber_wait: either the waiter sees the new head, or this sees the waiter
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&feed->waiter_count, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&feed->wait_mutex);
+        pthread_cond_broadcast(&feed->wait_cond);
+        pthread_mutex_unlock(&feed->wait_mutex);
+    }
+
+    return seq;
+}
+
+uint64_t change_feed_id(const ChangeFeed *feed) {
+    return feed != NULL ? feed->id : 0;
+}
+
+uint64_t change_feed_head(const ChangeFeed *feed) {
+    if (feed == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&((ChangeFeed *) feed)->head, memory_order_acquire);
+}
+
+ChangeFeedStatus change_subscriber_init(ChangeSubscriber *subscriber, const ChangeFeed *feed, uint64_t last_seq) {
+    if (subscriber == NULL || feed == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    subscriber->feed = feed;
+    subscriber->next_seq = last_seq + 1;
+    return CHANGE_FEED_OK;
+}
+
+ChangeFeedStatus change_subscriber_poll(ChangeSubscriber *subscriber, ChangeEvent *event) {
+    if (subscriber == NULL || subscriber->feed == NULL || event == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    ChangeFeed *feed = (ChangeFeed *) subscriber->feed;
+    uint64_t seq = subscriber->next_seq;
+    uint64_t head = atomic_load_explicit(&feed->head, memory_order_acquire);
+    if (seq > head) {
+        return CHANGE_FEED_EMPTY;
+    }
+    if (head - seq > feed->mask) {
+        return CHANGE_FEED_OVERRUN;
+    }
+
+    FeedSlot *slot = &feed->slots[seq & feed->mask];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) {
+        return CHANGE_FEED_OVERRUN;
+    }
+    uint64_t event_words[SLOT_WORD_COUNT];
+    for (size_t i = 0; i < SLOT_WORD_COUNT; ++i) {
+        event_words[i] = atomic_load_explicit(&slot->event_words[i], memory_order_relaxed);
+    }
+    // The copy is only valid if the publisher did not start rewriting the slot in the meantime
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+        return CHANGE_FEED_OVERRUN;
+    }
+    memcpy(event, event_words, sizeof(ChangeEvent));
+
+    subscriber->next_seq++;
+    return CHANGE_FEED_OK;
+}
+
+ChangeFeedStatus change_subscriber_wait(const ChangeSubscriber *subscriber, int timeout_ms) {
+    if (subscriber == NULL || subscriber->feed == NULL || timeout_ms < 0) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    ChangeFeed *feed = (ChangeFeed *) subscriber->feed;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    atomic_fetch_add_explicit(&feed->waiter_count, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    pthread_mutex_lock(&feed->wait_mutex);
+    int timeout_flag = 0;
+    while (!timeout_flag && atomic_load_explicit(&feed->head, memory_order_acquire) < subscriber->next_seq) {
+        timeout_flag = pthread_cond_timedwait(&feed->wait_cond, &feed->wait_mutex, &deadline) != 0;
+    }
+    pthread_mutex_unlock(&feed->wait_mutex);
+    atomic_fetch_sub_explicit(&feed->waiter_count, 1, memory_order_relaxed);
+
+    return atomic_load_explicit(&feed->head, memory_order_acquire) >= subscriber->next_seq ? CHANGE_FEED_OK
+                                                                                           : CHANGE_FEED_EMPTY;
+}
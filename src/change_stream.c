@@ -0,0 +1,581 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "change_stream.h"
+
+#define PUMP_BATCH_SIZE 64
+#define SERVER_POLL_INTERVAL_MS 100
+
+// The type byte of a record that marks lost events
+#define RECORD_OVERRUN 0
+// The type byte of the record that starts a stream, with sequence number 0 and the id of its feed
+#define RECORD_HEADER 255
+
+#define RECORD_TYPE_OFFSET 8
+#define RECORD_NAME_OFFSET (RECORD_TYPE_OFFSET + 1)
+#define RECORD_PHONE_OFFSET (RECORD_NAME_OFFSET + MAX_NAMELEN + 1)
+#define RECORD_EMAIL_OFFSET (RECORD_PHONE_OFFSET + MAX_PHONELEN + 1)
+#define RECORD_FEED_ID_OFFSET RECORD_NAME_OFFSET
+
+#define HANDSHAKE_SIZE 16
+
+// =================
+// = Record format =
+// =================
+
+static void encode_seq(unsigned char *record, uint64_t seq) {
+    for (int i = 0; i < 8; ++i) {
+        record[i] = (unsigned char) (seq >> (8 * i));
+    }
+}
+
+static uint64_t decode_seq(const unsigned char *record) {
+    uint64_t seq = 0;
+    for (int i = 7; i >= 0; --i) {
+        seq = (seq << 8) | record[i];
+    }
+    return seq;
+}
+
+static void encode_field(unsigned char *destination, const char *field, int maxlen) {
+    size_t length = strnlen(field, (size_t) maxlen);
+    memcpy(destination, field, length);
+    memset(destination + length, 0, (size_t) maxlen + 1 - length);
+}
+
+static void decode_field(char *field, const unsigned char *source, int maxlen) {
+    memcpy(field, source, (size_t) maxlen);
+    field[maxlen] = '\0';
+}
+
+static void encode_record(unsigned char *record, uint64_t seq, int type, const Contact *contact) {
+    encode_seq(record, seq);
+    record[RECORD_TYPE_OFFSET] = (unsigned char) type;
+    if (contact != NULL) {
+        encode_field(record + RECORD_NAME_OFFSET, contact->name, MAX_NAMELEN);
+        encode_field(record + RECORD_PHONE_OFFSET, contact->phone, MAX_PHONELEN);
+        encode_field(record + RECORD_EMAIL_OFFSET, contact->email, MAX_EMAILLEN);
+    } else {
+        memset(record + RECORD_NAME_OFFSET, 0, CHANGE_RECORD_SIZE - RECORD_NAME_OFFSET);
+    }
+}
+
+static void encode_header(unsigned char *record, const ChangeFeed *feed) {
+    encode_record(record, 0, RECORD_HEADER, NULL);
+    encode_seq(record + RECORD_FEED_ID_OFFSET, change_feed_id(feed));
+}
+
+// ===========
+// = Writing =
+// ===========
+
+// Returns 0 on success, 1 if the reading end was closed, -1 on other errors
+static int write_all(int fd, const unsigned char *data, size_t length, int socket_flag) {
+    while (length > 0) {
+        // Sockets are written with send, so that a disconnected client does not raise SIGPIPE
+        ssize_t written = socket_flag ? send(fd, data, length, MSG_NOSIGNAL) : write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EPIPE || errno == ECONNRESET ? 1 : -1;
+        }
+        data += written;
+        length -= (size_t) written;
+    }
+    return 0;
+}
+
+// Writes the available events. On an overrun, the overrun record is only written if overrun_record_flag is set
+static ChangeFeedStatus pump_events(ChangeSubscriber *subscriber, int fd, int socket_flag, int overrun_record_flag,
+                                    int *written_count) {
+    static _Thread_local unsigned char batch[PUMP_BATCH_SIZE * CHANGE_RECORD_SIZE];
+    int total_count = 0;
+    ChangeFeedStatus status;
+
+    do {
+        int batch_count = 0;
+        ChangeEvent event;
+        while (batch_count < PUMP_BATCH_SIZE &&
+               (status = change_subscriber_poll(subscriber, &event)) == CHANGE_FEED_OK) {
+            encode_record(batch + batch_count * CHANGE_RECORD_SIZE, event.seq, event.type, &event.contact);
+            batch_count++;
+        }
+        int event_count = batch_count;
+        if (status == CHANGE_FEED_OVERRUN && overrun_record_flag) {
+            encode_record(batch + batch_count * CHANGE_RECORD_SIZE, subscriber->next_seq, RECORD_OVERRUN, NULL);
+            batch_count++;
+        }
+
+        int write_result = write_all(fd, batch, (size_t) batch_count * CHANGE_RECORD_SIZE, socket_flag);
+        if (write_result != 0) {
+            status = write_result > 0 ? CHANGE_FEED_CLOSED : CHANGE_FEED_ERROR;
+            break;
+        }
+        total_count += event_count;
+    } while (status == CHANGE_FEED_OK);
+
+    if (written_count != NULL) {
+        *written_count = total_count;
+    }
+    return status == CHANGE_FEED_EMPTY ? CHANGE_FEED_OK : status;
+}
+
+ChangeFeedStatus change_stream_pump(ChangeSubscriber *subscriber, int fd, int *written_count) {
+    struct stat fd_stat;
+    if (subscriber == NULL || subscriber->feed == NULL || fstat(fd, &fd_stat) != 0) {
+        return CHANGE_FEED_ERROR;
+    }
+    // A new journal starts with the id of its feed, so that its sequence numbers are not mistaken for another feed's
+    if (S_ISREG(fd_stat.st_mode) && fd_stat.st_size == 0) {
+        unsigned char header[CHANGE_RECORD_SIZE];
+        encode_header(header, subscriber->feed);
+        if (write_all(fd, header, sizeof(header), 0) != 0) {
+            return CHANGE_FEED_ERROR;
+        }
+    }
+    return pump_events(subscriber, fd, S_ISSOCK(fd_stat.st_mode), 1, written_count);
+}
+
+// ===========
+// = Reading =
+// ===========
+
+ChangeFeedStatus change_stream_reader_init(ChangeStreamReader *reader, int fd) {
+    struct stat fd_stat;
+    if (reader == NULL || fstat(fd, &fd_stat) != 0) {
+        return CHANGE_FEED_ERROR;
+    }
+    reader->fd = fd;
+    reader->tail_flag = S_ISREG(fd_stat.st_mode);
+    reader->feed_id = 0;
+    reader->begin = 0;
+    reader->end = 0;
+    return CHANGE_FEED_OK;
+}
+
+// Reads the sequence number of the record at the given index of a journal file. Returns 0 on success
+static int read_record_seq(int fd, off_t index, uint64_t *seq) {
+    unsigned char record[CHANGE_RECORD_SIZE];
+    if (pread(fd, record, CHANGE_RECORD_SIZE, index * CHANGE_RECORD_SIZE) != CHANGE_RECORD_SIZE) {
+        return 1;
+    }
+    *seq = decode_seq(record);
+    return 0;
+}
+
+ChangeFeedStatus change_stream_seek(ChangeStreamReader *reader, uint64_t last_seq) {
+    struct stat fd_stat;
+    if (reader == NULL || !reader->tail_flag || fstat(reader->fd, &fd_stat) != 0) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    // The header is the first record, and sorts before all events with its sequence number 0
+    unsigned char header[CHANGE_RECORD_SIZE];
+    if (pread(reader->fd, header, CHANGE_RECORD_SIZE, 0) == CHANGE_RECORD_SIZE &&
+        header[RECORD_TYPE_OFFSET] == RECORD_HEADER) {
+        reader->feed_id = decode_seq(header + RECORD_FEED_ID_OFFSET);
+    }
+
+    // The sequence numbers in a journal only grow, but overrun records leave gaps in them,
+    // so the first record after last_seq is found with a binary search
+    off_t low = 0;
+    off_t high = fd_stat.st_size / CHANGE_RECORD_SIZE;
+    off_t record_count = high;
+    while (low < high) {
+        off_t middle = low + (high - low) / 2;
+        uint64_t seq;
+        if (read_record_seq(reader->fd, middle, &seq)) {
+            return CHANGE_FEED_ERROR;
+        }
+        if (seq <= last_seq) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    // The record found has to be the very next event, unless the events are not written yet
+    if (low < record_count) {
+        unsigned char record[CHANGE_RECORD_SIZE];
+        if (pread(reader->fd, record, CHANGE_RECORD_SIZE, low * CHANGE_RECORD_SIZE) != CHANGE_RECORD_SIZE) {
+            return CHANGE_FEED_ERROR;
+        }
+        if (decode_seq(record) != last_seq + 1 || record[RECORD_TYPE_OFFSET] == RECORD_OVERRUN) {
+            return CHANGE_FEED_OVERRUN;
+        }
+    }
+
+    if (lseek(reader->fd, low * CHANGE_RECORD_SIZE, SEEK_SET) < 0) {
+        return CHANGE_FEED_ERROR;
+    }
+    reader->begin = 0;
+    reader->end = 0;
+    return CHANGE_FEED_OK;
+}
+
+ChangeFeedStatus change_stream_read(ChangeStreamReader *reader, ChangeEvent *event) {
+    if (reader == NULL || event == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    const unsigned char *record;
+    int type;
+    do {
+        if (reader->end - reader->begin < CHANGE_RECORD_SIZE) {
+            // Keep the partial record at the start of the buffer, and fill the rest with what is available
+            memmove(reader->buffer, reader->buffer + reader->begin, (size_t) (reader->end - reader->begin));
+            reader->end -= reader->begin;
+            reader->begin = 0;
+        }
+        while (reader->end < CHANGE_RECORD_SIZE) {
+            ssize_t read_count = read(reader->fd, reader->buffer + reader->end,
+                                      (size_t) (CHANGE_READ_BUFFER_SIZE - reader->end));
+            if (read_count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return CHANGE_FEED_ERROR;
+            }
+            if (read_count == 0) {
+                // A partially written record stays buffered until the rest of it is appended
+                return reader->tail_flag ? CHANGE_FEED_EMPTY : CHANGE_FEED_CLOSED;
+            }
+            reader->end += (int) read_count;
+        }
+        record = reader->buffer + reader->begin;
+        reader->begin += CHANGE_RECORD_SIZE;
+
+        // The header only tells which feed the events that follow it come from
+        type = record[RECORD_TYPE_OFFSET];
+        if (type == RECORD_HEADER) {
+            reader->feed_id = decode_seq(record + RECORD_FEED_ID_OFFSET);
+        }
+    } while (type == RECORD_HEADER);
+
+    event->seq = decode_seq(record);
+    if (type == RECORD_OVERRUN) {
+        return CHANGE_FEED_OVERRUN;
+    }
+    if (type < CHANGE_ADD || type > CHANGE_SNAPSHOT_END) {
+        return CHANGE_FEED_ERROR;
+    }
+    event->type = (ChangeType) type;
+    decode_field(event->contact.name, record + RECORD_NAME_OFFSET, MAX_NAMELEN);
+    decode_field(event->contact.phone, record + RECORD_PHONE_OFFSET, MAX_PHONELEN);
+    decode_field(event->contact.email, record + RECORD_EMAIL_OFFSET, MAX_EMAILLEN);
+    return CHANGE_FEED_OK;
+}
+
+// ======================
+// = Unix socket server =
+// ======================
+
+typedef struct ServerClient {
+    struct ChangeFeedServer *server;
+    int fd;
+    pthread_t thread;
+    atomic_int done_flag;
+    struct ServerClient *next;
+} ServerClient;
+
+struct ChangeFeedServer {
+    const ContactDB *source;
+    const ChangeFeed *feed; // the feed of the source
+    int listen_fd;
+    char *socket_path;
+    pthread_t accept_thread;
+    atomic_int stop_flag;
+    ServerClient *clients; // only touched by the accept thread, and by change_feed_server_stop after joining it
+};
+
+// Waits until the descriptor is readable, checking the stop flag in between. Returns 0 once readable
+static int wait_readable(ChangeFeedServer *server, int fd) {
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    while (!atomic_load(&server->stop_flag)) {
+        int ready = poll(&poll_fd, 1, SERVER_POLL_INTERVAL_MS);
+        if (ready > 0) {
+            return 0;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return 1;
+        }
+    }
+    return 1;
+}
+
+// Sends a copy of the source, and moves the subscriber to the event the copy reflects
+static ChangeFeedStatus send_snapshot(ChangeFeedServer *server, int fd, ChangeSubscriber *subscriber) {
+    // The copy is taken first, so that the source is not locked while the client receives it
+    ContactDB snapshot;
+    contact_db_init(&snapshot, NULL);
+    uint64_t snapshot_seq;
+    if (contact_db_snapshot(server->source, &snapshot, &snapshot_seq) != CONTACT_OK) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    static _Thread_local unsigned char batch[PUMP_BATCH_SIZE * CHANGE_RECORD_SIZE];
+    encode_record(batch, snapshot_seq, CHANGE_SNAPSHOT_BEGIN, NULL);
+    int batch_count = 1;
+    int write_result = 0;
+    for (int i = 0; i <= snapshot.count && write_result == 0; ++i) {
+        if (i < snapshot.count) {
+            encode_record(batch + batch_count * CHANGE_RECORD_SIZE, snapshot_seq, CHANGE_SNAPSHOT_CONTACT,
+                          snapshot.contacts[i]);
+        } else {
+            encode_record(batch + batch_count * CHANGE_RECORD_SIZE, snapshot_seq, CHANGE_SNAPSHOT_END, NULL);
+        }
+        batch_count++;
+        if (batch_count == PUMP_BATCH_SIZE || i == snapshot.count) {
+            write_result = write_all(fd, batch, (size_t) batch_count * CHANGE_RECORD_SIZE, 1);
+            batch_count = 0;
+        }
+    }
+    contact_db_free(&snapshot);
+    if (write_result != 0) {
+        return write_result > 0 ? CHANGE_FEED_CLOSED : CHANGE_FEED_ERROR;
+    }
+
+    change_subscriber_init(subscriber, server->feed, snapshot_seq);
+    return CHANGE_FEED_OK;
+}
+
+// Streams the feed to a single client until it disconnects or the server stops
+static void serve_client(ChangeFeedServer *server, int fd) {
+    // The client starts by sending the id of the feed it follows and the sequence number to resume after
+    unsigned char handshake[HANDSHAKE_SIZE];
+    size_t received = 0;
+    while (received < sizeof(handshake)) {
+        if (wait_readable(server, fd)) {
+            return;
+        }
+        ssize_t read_count = recv(fd, handshake + received, sizeof(handshake) - received, 0);
+        if (read_count == 0 || (read_count < 0 && errno != EINTR)) {
+            return;
+        }
+        if (read_count > 0) {
+            received += (size_t) read_count;
+        }
+    }
+    uint64_t feed_id = decode_seq(handshake);
+    uint64_t last_seq = decode_seq(handshake + 8);
+
+    unsigned char header[CHANGE_RECORD_SIZE];
+    encode_header(header, server->feed);
+    if (write_all(fd, header, sizeof(header), 1) != 0) {
+        return;
+    }
+
+    // A position in another feed, e.g. the one before the server restarted, says nothing about this feed
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, server->feed, last_seq);
+    ChangeFeedStatus status = last_seq > 0 && feed_id != change_feed_id(server->feed) ? CHANGE_FEED_OVERRUN
+                                                                                      : CHANGE_FEED_OK;
+    while (!atomic_load(&server->stop_flag)) {
+        // A client the ring cannot serve, because it is new or fell behind, gets a snapshot and the events after it
+        if (status == CHANGE_FEED_OVERRUN) {
+            status = send_snapshot(server, fd, &subscriber);
+        } else {
+            status = pump_events(&subscriber, fd, 1, 0, NULL);
+            if (status == CHANGE_FEED_OK) {
+                // An idle client sleeps until the next event is published, waking up in between only to check
+                // the stop flag
+                change_subscriber_wait(&subscriber, SERVER_POLL_INTERVAL_MS);
+            }
+        }
+        if (status != CHANGE_FEED_OK && status != CHANGE_FEED_OVERRUN) {
+            return;
+        }
+    }
+}
+
+static void *client_thread(void *arg) {
+    ServerClient *client = arg;
+    serve_client(client->server, client->fd);
+    // The client sees the end of the stream right away, the descriptor itself is closed once the thread is joined
+    shutdown(client->fd, SHUT_RDWR);
+    atomic_store(&client->done_flag, 1);
+    return NULL;
+}
+
+static void join_clients(ChangeFeedServer *server, int all_flag) {
+    ServerClient **link = &server->clients;
+    while (*link != NULL) {
+        ServerClient *client = *link;
+        if (!all_flag && !atomic_load(&client->done_flag)) {
+            link = &client->next;
+            continue;
+        }
+        // Unblocks a client thread stuck in a write to a client that stopped reading
+        shutdown(client->fd, SHUT_RDWR);
+        pthread_join(client->thread, NULL);
+        close(client->fd);
+        *link = client->next;
+        free(client);
+    }
+}
+
+static void *accept_thread(void *arg) {
+    ChangeFeedServer *server = arg;
+    struct pollfd poll_fd = {server->listen_fd, POLLIN, 0};
+
+    while (!atomic_load(&server->stop_flag)) {
+        int ready = poll(&poll_fd, 1, SERVER_POLL_INTERVAL_MS);
+        // Clients that disconnected are cleaned up here, so a long-running server does not accumulate them
+        join_clients(server, 0);
+        if (ready <= 0) {
+            continue;
+        }
+
+        int client_fd = accept(server->listen_fd, NULL, NULL);
+        if (client_fd < 0) {
+            continue;
+        }
+        ServerClient *client = malloc(sizeof(ServerClient));
+        if (client == NULL) {
+            close(client_fd);
+            continue;
+        }
+        client->server = server;
+        client->fd = client_fd;
+        atomic_init(&client->done_flag, 0);
+        if (pthread_create(&client->thread, NULL, client_thread, client) != 0) {
+            close(client_fd);
+            free(client);
+            continue;
+        }
+        client->next = server->clients;
+        server->clients = client;
+    }
+
+    return NULL;
+}
+
+static int fill_socket_address(struct sockaddr_un *address, const char *socket_path) {
+    if (socket_path == NULL || strlen(socket_path) >= sizeof(address->sun_path)) {
+        return 1;
+    }
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socket_path);
+    return 0;
+}
+
+// Tells whether the socket at the address was left behind by a server that is gone, i.e. nobody accepts connections
+static int socket_is_stale(const struct sockaddr_un *address) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    int stale_flag = connect(fd, (const struct sockaddr *) address, sizeof(struct sockaddr_un)) != 0 &&
+                     errno == ECONNREFUSED;
+    close(fd);
+    return stale_flag;
+}
+
+ChangeFeedServer *change_feed_serve(const ContactDB *source, const char *socket_path) {
+    struct sockaddr_un address;
+    if (source == NULL || source->feed == NULL || fill_socket_address(&address, socket_path)) {
+        return NULL;
+    }
+
+    ChangeFeedServer *server = calloc(1, sizeof(ChangeFeedServer));
+    if (server == NULL) {
+        return NULL;
+    }
+    server->source = source;
+    server->feed = source->feed;
+    atomic_init(&server->stop_flag, 0);
+    server->socket_path = malloc(strlen(socket_path) + 1);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->socket_path == NULL || server->listen_fd < 0) {
+        fprintf(stderr, "Failed to create the change feed socket: %s\n", socket_path);
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        free(server->socket_path);
+        free(server);
+        return NULL;
+    }
+    strcpy(server->socket_path, socket_path);
+
+    // Only a socket left behind by an earlier server is replaced, any other file at the path is kept
+    struct stat path_stat;
+    if (lstat(socket_path, &path_stat) == 0) {
+        if (!S_ISSOCK(path_stat.st_mode)) {
+            fprintf(stderr, "Refusing to replace a file that is not a socket: %s\n", socket_path);
+            close(server->listen_fd);
+            free(server->socket_path);
+            free(server);
+            return NULL;
+        }
+        if (!socket_is_stale(&address)) {
+            fprintf(stderr, "Another server is already serving on the socket: %s\n", socket_path);
+            close(server->listen_fd);
+            free(server->socket_path);
+            free(server);
+            return NULL;
+        }
+        unlink(socket_path);
+    }
+    // The path is only unlinked on failure once it was bound, so it can no longer belong to another server
+    int bound_flag = bind(server->listen_fd, (struct sockaddr *) &address, sizeof(address)) == 0;
+    if (!bound_flag ||
+        listen(server->listen_fd, SOMAXCONN) != 0 ||
+        pthread_create(&server->accept_thread, NULL, accept_thread, server) != 0) {
+        fprintf(stderr, "Failed to start serving the change feed on the socket: %s\n", socket_path);
+        close(server->listen_fd);
+        if (bound_flag) {
+            unlink(socket_path);
+        }
+        free(server->socket_path);
+        free(server);
+        return NULL;
+    }
+
+    return server;
+}
+
+void change_feed_server_stop(ChangeFeedServer *server) {
+    if (server == NULL) {
+        return;
+    }
+
+    atomic_store(&server->stop_flag, 1);
+    pthread_join(server->accept_thread, NULL);
+    join_clients(server, 1);
+
+    close(server->listen_fd);
+    unlink(server->socket_path);
+    free(server->socket_path);
+    free(server);
+}
+
+int change_feed_connect(const char *socket_path, uint64_t feed_id, uint64_t last_seq) {
+    struct sockaddr_un address;
+    if (fill_socket_address(&address, socket_path)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unsigned char handshake[HANDSHAKE_SIZE];
+    encode_seq(handshake, feed_id);
+    encode_seq(handshake + 8, last_seq);
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        write_all(fd, handshake, sizeof(handshake), 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,410 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "contact_db.h"
+
+#define INITIAL_DB_CAPACITY 16
+
+// ==============
+// = Name index =
+// ==============
+
+// The contacts are indexed by name in an open addressing table, so that the duplicate check of contact_db_add
+// does not scan the whole database. The contacts never move in memory, so the slots point at them directly
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261U; // FNV-1a
+    for (; *name != '\0'; ++name) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static void index_insert(ContactIndexSlot *name_index, size_t index_size, uint32_t hash, Contact *contact) {
+    size_t mask = index_size - 1;
+    size_t slot = hash & mask;
+    while (name_index[slot].contact != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    name_index[slot].hash = hash;
+    name_index[slot].contact = contact;
+}
+
+// Returns the slot of the contact with the name, or index_size if there is none
+static size_t index_find(const ContactDB *db, const char *name, uint32_t hash) {
+    if (db->name_index == NULL) {
+        return db->index_size;
+    }
+    size_t mask = db->index_size - 1;
+    for (size_t slot = hash & mask; db->name_index[slot].contact != NULL; slot = (slot + 1) & mask) {
+        if (db->name_index[slot].hash == hash && strcmp(db->name_index[slot].contact->name, name) == 0) {
+            return slot;
+        }
+    }
+    return db->index_size;
+}
+
+// Empties the slot, moving back the entries after it that could otherwise no longer be found
+static void index_remove(ContactDB *db, size_t hole) {
+    size_t mask = db->index_size - 1;
+    for (size_t slot = (hole + 1) & mask; db->name_index[slot].contact != NULL; slot = (slot + 1) & mask) {
+        size_t home = db->name_index[slot].hash & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            db->name_index[hole] = db->name_index[slot];
+            hole = slot;
+        }
+    }
+    db->name_index[hole].contact = NULL;
+}
+
+// Builds the index of the contacts, with room for reserve_count contacts at most half filling it
+static ContactIndexSlot *index_build(const ContactAllocator *allocator, Contact **contacts, int contact_count,
+                                     int reserve_count, size_t *index_size) {
+    size_t size = INITIAL_DB_CAPACITY * 2;
+    while ((size_t) reserve_count * 2 > size) {
+        size *= 2;
+    }
+    ContactIndexSlot *name_index = allocator->allocate(allocator->context, sizeof(ContactIndexSlot) * size);
+    if (name_index == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        name_index[i].contact = NULL;
+    }
+    for (int i = 0; i < contact_count; ++i) {
+        index_insert(name_index, size, hash_name(contacts[i]->name), contacts[i]);
+    }
+    *index_size = size;
+    return name_index;
+}
+
+// Makes room in the index for one more contact, doubling its size when needed. Returns 0 on success
+static int index_reserve(ContactDB *db) {
+    if (db->name_index != NULL && (size_t) (db->count + 1) * 2 <= db->index_size) {
+        return 0;
+    }
+    size_t new_size;
+    ContactIndexSlot *new_index = index_build(&db->allocator, db->contacts, db->count, db->count + 1, &new_size);
+    if (new_index == NULL) {
+        return 1;
+    }
+    if (db->name_index != NULL) {
+        db->allocator.deallocate(db->allocator.context, db->name_index, sizeof(ContactIndexSlot) * db->index_size);
+    }
+    db->name_index = new_index;
+    db->index_size = new_size;
+    return 0;
+}
+
+// ============
+// = Database =
+// ============
+
+ContactStatus contact_db_init(ContactDB *db, const ContactAllocator *allocator) {
+    if (db == NULL) {
+        return CONTACT_ERR_INVALID;
+    }
+
+    db->contacts = NULL;
+    db->count = 0;
+    db->capacity = 0;
+    db->name_index = NULL;
+    db->index_size = 0;
+    db->allocator = allocator != NULL ? *allocator : *system_allocator();
+    db->feed = NULL;
+    return CONTACT_OK;
+}
+
+void contact_db_attach_feed(ContactDB *db, ChangeFeed *feed) {
+    if (db == NULL) {
+        return;
+    }
+    db->feed = feed;
+}
+
+void contact_db_free(ContactDB *db) {
+    if (db == NULL) {
+        return;
+    }
+
+    const ContactAllocator *allocator = &db->allocator;
+    for (int i = 0; i < db->count; ++i) {
+        allocator->deallocate(allocator->context, db->contacts[i], sizeof(Contact));
+    }
+    if (db->contacts != NULL) {
+        allocator->deallocate(allocator->context, db->contacts, sizeof(Contact *) * db->capacity);
+    }
+    if (db->name_index != NULL) {
+        allocator->deallocate(allocator->context, db->name_index, sizeof(ContactIndexSlot) * db->index_size);
+    }
+    db->contacts = NULL;
+    db->count = 0;
+    db->capacity = 0;
+    db->name_index = NULL;
+    db->index_size = 0;
+}
+
+// Adds a contact whose fields were validated. Called with the feed locked, if there is one
+static ContactStatus insert_contact(ContactDB *db, const char *name, const char *phone, const char *email) {
+    uint32_t hash = hash_name(name);
+    if (index_find(db, name, hash) != db->index_size) {
+        return CONTACT_ERR_DUPLICATE;
+    }
+
+    // Growing the array or the index is harmless if a later allocation fails, the contacts stay the same
+    const ContactAllocator *allocator = &db->allocator;
+    if (db->count == db->capacity) {
+        if (db->capacity > INT_MAX / 2) {
+            return CONTACT_ERR_NO_MEMORY;
+        }
+        // Grow geometrically, so that adding a contact reallocates the array only once in a while
+        int new_capacity = db->capacity > 0 ? db->capacity * 2 : INITIAL_DB_CAPACITY;
+        Contact **new_contacts = allocator->reallocate(allocator->context, db->contacts,
+                                                       sizeof(Contact *) * db->capacity,
+                                                       sizeof(Contact *) * new_capacity);
+        if (new_contacts == NULL) {
+            return CONTACT_ERR_NO_MEMORY;
+        }
+        db->contacts = new_contacts;
+        db->capacity = new_capacity;
+    }
+    if (index_reserve(db)) {
+        return CONTACT_ERR_NO_MEMORY;
+    }
+
+    Contact *new_contact = allocator->allocate(allocator->context, sizeof(Contact));
+    if (new_contact == NULL) {
+        return CONTACT_ERR_NO_MEMORY;
+    }
+    strcpy(new_contact->name, name);
+    strcpy(new_contact->phone, phone);
+    strcpy(new_contact->email, email);
+
+    db->contacts[db->count] = new_contact;
+    db->count++;
+    index_insert(db->name_index, db->index_size, hash, new_contact);
+
+    if (db->feed != NULL) {
+        change_feed_publish(db->feed, CHANGE_ADD, new_contact);
+    }
+    return CONTACT_OK;
+}
+
+// Deletes the contact with the name. Called with the feed locked, if there is one
+static ContactStatus remove_contact(ContactDB *db, const char *name) {
+    size_t slot = index_find(db, name, hash_name(name));
+    if (slot == db->index_size) {
+        return CONTACT_ERR_NOT_FOUND;
+    }
+    Contact *contact = db->name_index[slot].contact;
+    index_remove(db, slot);
+
+    // The contacts are kept in the order they were added, so the position in the array still has to be looked up
+    int i = 0;
+    while (db->contacts[i] != contact) {
+        i++;
+    }
+    if (db->feed != NULL) {
+        change_feed_publish(db->feed, CHANGE_DELETE, contact);
+    }
+    db->allocator.deallocate(db->allocator.context, contact, sizeof(Contact));
+    // Only the pointers after the deleted contact are shifted, the contacts themselves stay in place
+    memmove(&db->contacts[i], &db->contacts[i + 1], sizeof(Contact *) * (db->count - i - 1));
+    db->count--;
+    return CONTACT_OK;
+}
+
+ContactStatus contact_db_add(ContactDB *db, const char *name, const char *phone, const char *email) {
+    if (db == NULL ||
+        validate_info(name, MAX_NAMELEN) ||
+        validate_info(phone, MAX_PHONELEN) ||
+        validate_info(email, MAX_EMAILLEN)) {
+        return CONTACT_ERR_INVALID;
+    }
+
+    // The change and its event happen under the lock of the feed, so that a copy made on another thread
+    // always matches the events published before it
+    change_feed_write_lock(db->feed);
+    ContactStatus status = insert_contact(db, name, phone, email);
+    change_feed_unlock(db->feed);
+    return status;
+}
+
+Contact *contact_db_search(const ContactDB *db, const char *name) {
+    if (db == NULL ||
+        validate_info(name, MAX_NAMELEN)) {
+        return NULL;
+    }
+    size_t slot = index_find(db, name, hash_name(name));
+    return slot != db->index_size ? db->name_index[slot].contact : NULL;
+}
+
+ContactStatus contact_db_delete(ContactDB *db, const char *name) {
+    if (db == NULL ||
+        validate_info(name, MAX_NAMELEN)) {
+        return CONTACT_ERR_INVALID;
+    }
+
+    change_feed_write_lock(db->feed);
+    ContactStatus status = remove_contact(db, name);
+    change_feed_unlock(db->feed);
+    return status;
+}
+
+// Replaces the contents of the copy with the contacts of the source. Called with the feed of the source locked
+static ContactStatus copy_contacts(const ContactDB *source, ContactDB *copy) {
+    // The contacts are copied into new memory first, so that a failed allocation leaves the copy as it was
+    const ContactAllocator *allocator = &copy->allocator;
+    Contact **contacts = NULL;
+    if (source->count > 0) {
+        contacts = allocator->allocate(allocator->context, sizeof(Contact *) * source->count);
+        if (contacts == NULL) {
+            return CONTACT_ERR_NO_MEMORY;
+        }
+    }
+    for (int i = 0; i < source->count; ++i) {
+        contacts[i] = allocator->allocate(allocator->context, sizeof(Contact));
+        if (contacts[i] == NULL) {
+            while (i-- > 0) {
+                allocator->deallocate(allocator->context, contacts[i], sizeof(Contact));
+            }
+            allocator->deallocate(allocator->context, contacts, sizeof(Contact *) * source->count);
+            return CONTACT_ERR_NO_MEMORY;
+        }
+        *contacts[i] = *source->contacts[i];
+    }
+    size_t index_size = 0;
+    ContactIndexSlot *name_index = NULL;
+    if (source->count > 0) {
+        name_index = index_build(allocator, contacts, source->count, source->count, &index_size);
+        if (name_index == NULL) {
+            for (int i = 0; i < source->count; ++i) {
+                allocator->deallocate(allocator->context, contacts[i], sizeof(Contact));
+            }
+            allocator->deallocate(allocator->context, contacts, sizeof(Contact *) * source->count);
+            return CONTACT_ERR_NO_MEMORY;
+        }
+    }
+
+    contact_db_free(copy);
+    copy->contacts = contacts;
+    copy->count = source->count;
+    copy->capacity = source->count;
+    copy->name_index = name_index;
+    copy->index_size = index_size;
+    return CONTACT_OK;
+}
+
+ContactStatus contact_db_snapshot(const ContactDB *source, ContactDB *copy, uint64_t *head_seq) {
+    if (source == NULL || copy == NULL || source == copy) {
+        return CONTACT_ERR_INVALID;
+    }
+
+    // The thread modifying the source waits while it is copied, so the copy reflects exactly the events up to the head
+    change_feed_read_lock(source->feed);
+    ContactStatus status = copy_contacts(source, copy);
+    uint64_t source_head = change_feed_head(source->feed);
+    change_feed_unlock(source->feed);
+
+    if (status == CONTACT_OK && head_seq != NULL) {
+        *head_seq = source_head;
+    }
+    return status;
+}
+
+// Reads a single line of the file into the field, without the line break. Returns CONTACT_OK,
+// CONTACT_ERR_NOT_FOUND at the end of the file, CONTACT_ERR_INVALID if the line is too long, or CONTACT_ERR_IO
+static ContactStatus read_field_line(FILE *file, char *line, int line_size) {
+    if (fgets(line, line_size, file) == NULL) {
+        return ferror(file) ? CONTACT_ERR_IO : CONTACT_ERR_NOT_FOUND;
+    }
+    size_t length = strlen(line);
+    if (length > 0 && line[length - 1] == '\n') {
+        line[--length] = '\0';
+    } else if (!feof(file)) {
+        return CONTACT_ERR_INVALID;
+    }
+    if (length > 0 && line[length - 1] == '\r') {
+        line[--length] = '\0';
+    }
+    return CONTACT_OK;
+}
+
+ContactStatus contact_db_load_from_file(ContactDB *db, const char *input_file) {
+    if (db == NULL || input_file == NULL) {
+        return CONTACT_ERR_INVALID;
+    }
+
+    FILE *file = fopen(input_file, "r");
+    if (file == NULL) {
+        // A database that was never saved yet is simply empty
+        return errno == ENOENT ? CONTACT_OK : CONTACT_ERR_IO;
+    }
+
+    // The buffers fit the longest valid field, its line break (possibly \r\n) and the terminating zero,
+    // so a longer line is detected as one that does not end within the buffer
+    char name[MAX_NAMELEN + 3];
+    char phone[MAX_PHONELEN + 3];
+    char email[MAX_EMAILLEN + 3];
+    ContactStatus status;
+    while ((status = read_field_line(file, name, sizeof(name))) == CONTACT_OK) {
+        status = read_field_line(file, phone, sizeof(phone));
+        if (status == CONTACT_OK) {
+            status = read_field_line(file, email, sizeof(email));
+        }
+        if (status == CONTACT_OK) {
+            status = contact_db_add(db, name, phone, email);
+        }
+        if (status != CONTACT_OK) {
+            // A contact cut off by the end of the file is as invalid as one with an invalid field
+            status = status == CONTACT_ERR_NOT_FOUND ? CONTACT_ERR_INVALID : status;
+            break;
+        }
+    }
+
+    fclose(file);
+    return status == CONTACT_ERR_NOT_FOUND ? CONTACT_OK : status;
+}
+
+int contact_db_save_to_file(const ContactDB *db, const char *output_file) {
+    if (db == NULL || output_file == NULL) {
+        return 1;
+    }
+
+    // The file is written from a contiguous copy, the same way the legacy database is saved
+    Contact *contacts = NULL;
+    if (db->count > 0) {
+        contacts = malloc(sizeof(Contact) * db->count);
+        if (contacts == NULL) {
+            fprintf(stderr, "Failed to allocate memory to save the contacts: %s\n", output_file);
+            return 1;
+        }
+        for (int i = 0; i < db->count; ++i) {
+            contacts[i] = *db->contacts[i];
+        }
+    }
+    int error_flag = save_contacts_to_file(contacts, db->count, output_file);
+    free(contacts);
+    return error_flag;
+}
+
+const char *contact_status_message(ContactStatus status) {
+    switch (status) {
+        case CONTACT_OK:
+            return "Success";
+        case CONTACT_ERR_INVALID:
+            return "Invalid contact information";
+        case CONTACT_ERR_DUPLICATE:
+            return "Contact with such name already exists in the database";
+        case CONTACT_ERR_NOT_FOUND:
+            return "Contact was not found";
+        case CONTACT_ERR_NO_MEMORY:
+            return "Failed to allocate memory";
+        case CONTACT_ERR_IO:
+            return "Failed to read or write the file";
+    }
+    return "Unknown status";
+}
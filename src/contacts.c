@@ -7,7 +7,7 @@
 // - data is not longer than max specification
 // - data is not empty
 // - data does not contain newlines
-static int validate_info(const char *data, int maxlen) {
+int validate_info(const char *data, int maxlen) {
     if ((data == NULL) ||
         (strlen(data) > maxlen) ||
         (strlen(data) == 0) ||
@@ -37,12 +37,12 @@ Contact *add_contact(const char *name, const char *phone, const char *email, Con
     strcpy(new_contact.phone, phone);
     strcpy(new_contact.email, email);
 
+    // On failure the original database is still valid and owned by the caller
     Contact *updated_database = realloc(database, sizeof(Contact) * (*contact_count + 1));
     if (updated_database == NULL) {
         fprintf(stderr, "Failed to reallocate memory for a new contact:\n");
         print_contact(new_contact);
-        free(database);
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
     updated_database[*contact_count] = new_contact;
@@ -92,10 +92,10 @@ Contact *delete_contact(const char *name, Contact *database, int *contact_count)
     // which effectively frees the memory held by database and sets it to NULL
     // but this behavior is expected, thus for an error we additionally check if contact_count > 1
     if (updated_database == NULL && *contact_count > 1) {
-        fprintf(stderr, "Failed to delete the following contact:\n");
+        // Shrinking failed, but the old block is still valid and large enough, so the deletion itself succeeded
+        fprintf(stderr, "Failed to shrink the memory after deleting the following contact:\n");
         print_contact(contact_to_delete);
-        free(database);
-        exit(EXIT_FAILURE);
+        updated_database = database;
     }
 
     (*contact_count)--;
@@ -115,12 +115,12 @@ void list_contacts(const Contact *database, int contact_count) {
     }
 }
 
-void save_contacts_to_file(Contact *database, int contact_count, const char *output_file) {
+int save_contacts_to_file(Contact *database, int contact_count, const char *output_file) {
     FILE *file;
     file = fopen(output_file, "w");
     if (file == NULL) {
         fprintf(stderr, "Failed to open the file to save contacts: %s\n", output_file);
-        return;
+        return 1;
     }
 
     for (int i = 0; i < contact_count; ++i) {
@@ -129,7 +129,13 @@ void save_contacts_to_file(Contact *database, int contact_count, const char *out
         fprintf(file, "%s\n", database[i].email);
     }
 
-    fclose(file);
+    // A full disk only shows up as a stream error or a failing fclose (when the buffer is flushed)
+    int error_flag = ferror(file);
+    if (fclose(file) != 0 || error_flag) {
+        fprintf(stderr, "Failed to write contacts to the file: %s\n", output_file);
+        return 1;
+    }
+    return 0;
 }
 
 static void print_invalid_contact_msg(int contact_count, const char *invalid_data_label, char *invalid_data) {
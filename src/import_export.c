@@ -0,0 +1,1377 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "import_export.h"
+
+#define READ_CHUNK_SIZE (1 << 20)
+#define WRITE_BUFFER_SIZE (1 << 20)
+#define INITIAL_IMPORT_CAPACITY 1024
+#define CSV_MAX_COLUMNS 256
+#define CSV_HEADER_MAXLEN 16
+#define VCARD_PROPERTY_MAXLEN 512
+#define VCARD_FOLD_WIDTH 75
+#define JSON_KEY_MAXLEN 16
+
+typedef enum {
+    FIELD_NAME,
+    FIELD_PHONE,
+    FIELD_EMAIL,
+    FIELD_COUNT
+} ContactField;
+
+static const char *field_labels[FIELD_COUNT] = {"name", "phone", "email"};
+static const int field_maxlens[FIELD_COUNT] = {MAX_NAMELEN, MAX_PHONELEN, MAX_EMAILLEN};
+
+// =======================
+// = Chunked line reader =
+// =======================
+
+// Lines are returned as pointers into the chunk buffer, so the data is never copied line by line.
+// A line that does not fit into the remaining part of the chunk is moved to the front before the next read.
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t capacity;
+    size_t start; // beginning of the data that was not returned yet
+    size_t end; // end of the data read from the file
+    long line_number; // number of the line returned last
+    int eof_flag;
+    int error_flag;
+} LineReader;
+
+static int line_reader_init(LineReader *reader, FILE *file) {
+    memset(reader, 0, sizeof(LineReader));
+    reader->file = file;
+    reader->buffer = malloc(READ_CHUNK_SIZE);
+    reader->capacity = READ_CHUNK_SIZE;
+    return reader->buffer == NULL;
+}
+
+// Returns the next line without its line terminator, or NULL at the end of the input (or on error).
+// The line stays valid only until the next call
+static char *read_line(LineReader *reader, size_t *length) {
+    while (1) {
+        char *data = reader->buffer + reader->start;
+        size_t available = reader->end - reader->start;
+        char *newline = memchr(data, '\n', available);
+
+        if (newline != NULL || (reader->eof_flag && available > 0)) {
+            size_t line_length = newline != NULL ? (size_t) (newline - data) : available;
+            reader->start += newline != NULL ? line_length + 1 : line_length;
+            if (line_length > 0 && data[line_length - 1] == '\r') {
+                line_length--;
+            }
+            // There is always at least one spare byte after the data, so the last line can be terminated as well
+            data[line_length] = '\0';
+            reader->line_number++;
+
+            // Skip the UTF-8 byte order mark, which is commonly written by spreadsheet exports
+            if (reader->line_number == 1 && line_length >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+                data += 3;
+                line_length -= 3;
+            }
+            *length = line_length;
+            return data;
+        }
+        if (reader->eof_flag) {
+            return NULL;
+        }
+
+        if (reader->start > 0) {
+            memmove(reader->buffer, data, available);
+            reader->start = 0;
+            reader->end = available;
+        }
+        if (reader->end + 1 >= reader->capacity) {
+            char *new_buffer = realloc(reader->buffer, reader->capacity * 2);
+            if (new_buffer == NULL) {
+                reader->error_flag = 1;
+                return NULL;
+            }
+            reader->buffer = new_buffer;
+            reader->capacity *= 2;
+        }
+
+        size_t read_count = fread(reader->buffer + reader->end, 1, reader->capacity - reader->end - 1, reader->file);
+        reader->end += read_count;
+        if (read_count == 0) {
+            reader->error_flag = ferror(reader->file) != 0;
+            reader->eof_flag = 1;
+        }
+    }
+}
+
+// ==================
+// = Contact drafts =
+// ==================
+
+// A field is filled one character at a time directly inside the draft contact,
+// characters over the field limit are dropped and only remembered by the overflow flag.
+// NUL characters would silently cut the C string short, so they are only remembered by the NUL flag
+typedef struct {
+    char *data;
+    int length;
+    int maxlen;
+    int overflow_flag;
+    int nul_flag;
+    int present_flag;
+} FieldBuffer;
+
+typedef struct {
+    Contact contact;
+    FieldBuffer fields[FIELD_COUNT];
+} ContactDraft;
+
+static void field_init(FieldBuffer *field, char *data, int maxlen) {
+    field->data = data;
+    field->data[0] = '\0';
+    field->length = 0;
+    field->maxlen = maxlen;
+    field->overflow_flag = 0;
+    field->nul_flag = 0;
+    field->present_flag = 0;
+}
+
+static void field_clear(FieldBuffer *field) {
+    field->data[0] = '\0';
+    field->length = 0;
+    field->overflow_flag = 0;
+    field->nul_flag = 0;
+}
+
+static void field_append(FieldBuffer *field, char c) {
+    if (c == '\0') {
+        field->nul_flag = 1;
+    } else if (field->length < field->maxlen) {
+        field->data[field->length++] = c;
+        field->data[field->length] = '\0';
+    } else {
+        field->overflow_flag = 1;
+    }
+}
+
+static void draft_reset(ContactDraft *draft) {
+    field_init(&draft->fields[FIELD_NAME], draft->contact.name, MAX_NAMELEN);
+    field_init(&draft->fields[FIELD_PHONE], draft->contact.phone, MAX_PHONELEN);
+    field_init(&draft->fields[FIELD_EMAIL], draft->contact.email, MAX_EMAILLEN);
+}
+
+// ==================
+// = Bulk insertion =
+// ==================
+
+// Contacts are appended to a geometrically growing database, and duplicate names are detected
+// with a hash index instead of search_contact, which would make the import quadratic
+typedef struct {
+    uint32_t hash; // kept in the slot, so probing and rebuilding rarely touch the contacts themselves
+    int database_index; // -1 marks an empty slot
+} IndexSlot;
+
+typedef struct {
+    Contact *database;
+    int count;
+    int capacity;
+    IndexSlot *name_index; // open addressing table
+    size_t index_size;
+    ContactDB *db; // when set, the contacts are added through the handle instead of the fields above
+    ContactStatus db_status; // why the import into the handle stopped early
+    const char *source_name;
+    ImportReport report;
+} ImportTarget;
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261U; // FNV-1a
+    for (; *name != '\0'; ++name) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static int index_contains(const ImportTarget *target, const char *name, uint32_t hash) {
+    size_t mask = target->index_size - 1;
+    for (size_t slot = hash & mask; target->name_index[slot].database_index != -1; slot = (slot + 1) & mask) {
+        if (target->name_index[slot].hash == hash &&
+            strcmp(target->database[target->name_index[slot].database_index].name, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void index_insert(IndexSlot *name_index, size_t index_size, uint32_t hash, int database_index) {
+    size_t mask = index_size - 1;
+    size_t slot = hash & mask;
+    while (name_index[slot].database_index != -1) {
+        slot = (slot + 1) & mask;
+    }
+    name_index[slot].hash = hash;
+    name_index[slot].database_index = database_index;
+}
+
+// Keeps the index at most half full, rebuilding it with twice the size when needed
+static int index_reserve(ImportTarget *target, int contact_count) {
+    if (target->name_index != NULL && (size_t) contact_count * 2 <= target->index_size) {
+        return 0;
+    }
+
+    size_t new_size = target->index_size > 0 ? target->index_size : INITIAL_IMPORT_CAPACITY * 2;
+    while ((size_t) contact_count * 2 > new_size) {
+        new_size *= 2;
+    }
+    IndexSlot *new_index = malloc(sizeof(IndexSlot) * new_size);
+    if (new_index == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < new_size; ++i) {
+        new_index[i].database_index = -1;
+    }
+
+    if (target->name_index != NULL) {
+        for (size_t i = 0; i < target->index_size; ++i) {
+            if (target->name_index[i].database_index != -1) {
+                index_insert(new_index, new_size, target->name_index[i].hash, target->name_index[i].database_index);
+            }
+        }
+    } else {
+        for (int i = 0; i < target->count; ++i) {
+            index_insert(new_index, new_size, hash_name(target->database[i].name), i);
+        }
+    }
+
+    free(target->name_index);
+    target->name_index = new_index;
+    target->index_size = new_size;
+    return 0;
+}
+
+static void report_rejected(ImportTarget *target, long line_number, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s:%ld: skipping contact, ", target->source_name, line_number);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    target->report.skipped++;
+    if (target->report.first_error_line == 0) {
+        target->report.first_error_line = line_number;
+    }
+}
+
+static void report_fatal(ImportTarget *target, long line_number, const char *message) {
+    fprintf(stderr, "%s:%ld: %s, stopping the import\n", target->source_name, line_number, message);
+    target->report.error_flag = 1;
+}
+
+// The handle checks the name with its own index, grows its array of contacts geometrically,
+// and publishes the addition to its feed
+static int submit_to_db(ImportTarget *target, const ContactDraft *draft, long line_number) {
+    ContactStatus status = contact_db_add(target->db, draft->contact.name, draft->contact.phone,
+                                          draft->contact.email);
+    if (status == CONTACT_ERR_NO_MEMORY) {
+        target->db_status = status;
+        report_fatal(target, line_number, "Failed to allocate memory for the imported contact");
+        return 1;
+    }
+    if (status == CONTACT_ERR_DUPLICATE) {
+        report_rejected(target, line_number, "name is already in the database: %s", draft->contact.name);
+        return 0;
+    }
+    if (status != CONTACT_OK) {
+        report_rejected(target, line_number, "%s", contact_status_message(status));
+        return 0;
+    }
+    target->report.imported++;
+    return 0;
+}
+
+// Validates the draft with the same rules as add_contact and appends it to the database.
+// Returns 0 if the draft was processed (added or rejected), 1 if the import cannot continue
+static int submit_draft(ImportTarget *target, ContactDraft *draft, long line_number) {
+    for (int i = 0; i < FIELD_COUNT; ++i) {
+        const FieldBuffer *field = &draft->fields[i];
+        if (!field->present_flag) {
+            report_rejected(target, line_number, "%s is missing", field_labels[i]);
+            return 0;
+        }
+        if (field->overflow_flag) {
+            report_rejected(target, line_number, "%s is longer than %d characters", field_labels[i], field->maxlen);
+            return 0;
+        }
+        if (field->nul_flag) {
+            report_rejected(target, line_number, "%s contains a NUL character", field_labels[i]);
+            return 0;
+        }
+        if (validate_info(field->data, field_maxlens[i])) {
+            report_rejected(target, line_number, "%s is empty or contains a newline", field_labels[i]);
+            return 0;
+        }
+    }
+    if (target->db != NULL) {
+        return submit_to_db(target, draft, line_number);
+    }
+    uint32_t hash = hash_name(draft->contact.name);
+    if (index_contains(target, draft->contact.name, hash)) {
+        report_rejected(target, line_number, "name is already in the database: %s", draft->contact.name);
+        return 0;
+    }
+
+    if (target->count == target->capacity) {
+        if (target->capacity == INT_MAX) {
+            report_fatal(target, line_number, "The database is full");
+            return 1;
+        }
+        int new_capacity = target->capacity > INITIAL_IMPORT_CAPACITY ? target->capacity : INITIAL_IMPORT_CAPACITY;
+        new_capacity = new_capacity > INT_MAX / 2 ? INT_MAX : new_capacity * 2;
+        Contact *updated_database = realloc(target->database, sizeof(Contact) * new_capacity);
+        if (updated_database == NULL) {
+            report_fatal(target, line_number, "Failed to reallocate memory for the imported contacts");
+            return 1;
+        }
+        target->database = updated_database;
+        target->capacity = new_capacity;
+    }
+    if (index_reserve(target, target->count + 1)) {
+        report_fatal(target, line_number, "Failed to allocate memory for the name index");
+        return 1;
+    }
+
+    target->database[target->count] = draft->contact;
+    index_insert(target->name_index, target->index_size, hash, target->count);
+    target->count++;
+    target->report.imported++;
+    return 0;
+}
+
+// ================
+// = CSV importer =
+// ================
+
+typedef enum {
+    CSV_FIELD_START,
+    CSV_UNQUOTED,
+    CSV_QUOTED,
+    CSV_QUOTE_IN_QUOTED // a quote was read inside a quoted field, it is either escaped or closes the field
+} CsvState;
+
+static int is_blank_line(const char *line, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        if (line[i] != ' ' && line[i] != '\t') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Matches the header columns against the field labels. If not all fields are named in the line,
+// it is not a header, and the columns are expected in the name, phone, email order
+static int csv_parse_header(const char *line, int *column_fields, int *field_columns) {
+    int found_count = 0;
+    for (int i = 0; i < FIELD_COUNT; ++i) {
+        field_columns[i] = -1;
+    }
+
+    int column = 0;
+    const char *cursor = line;
+    while (column < CSV_MAX_COLUMNS) {
+        char label[CSV_HEADER_MAXLEN + 1];
+        int label_length = 0;
+        int in_quotes = 0;
+        for (; *cursor != '\0' && (in_quotes || *cursor != ','); ++cursor) {
+            if (*cursor == '"') {
+                in_quotes = !in_quotes;
+            } else if (*cursor != ' ' && label_length < CSV_HEADER_MAXLEN) {
+                label[label_length++] = *cursor;
+            }
+        }
+        label[label_length] = '\0';
+
+        column_fields[column] = -1;
+        for (int i = 0; i < FIELD_COUNT; ++i) {
+            if (field_columns[i] == -1 && strcasecmp(label, field_labels[i]) == 0) {
+                column_fields[column] = i;
+                field_columns[i] = column;
+                found_count++;
+            }
+        }
+
+        column++;
+        if (*cursor == '\0') {
+            break;
+        }
+        cursor++;
+    }
+    for (; column < CSV_MAX_COLUMNS; ++column) {
+        column_fields[column] = -1;
+    }
+
+    if (found_count == FIELD_COUNT) {
+        return 1;
+    }
+    for (int i = 0; i < CSV_MAX_COLUMNS; ++i) {
+        column_fields[i] = i < FIELD_COUNT ? i : -1;
+    }
+    for (int i = 0; i < FIELD_COUNT; ++i) {
+        field_columns[i] = i;
+    }
+    return 0;
+}
+
+static void import_csv(LineReader *reader, ImportTarget *target) {
+    int column_fields[CSV_MAX_COLUMNS];
+    int field_columns[FIELD_COUNT];
+    int header_checked = 0;
+
+    ContactDraft draft;
+    CsvState state = CSV_FIELD_START;
+    int column = 0;
+    int in_record = 0;
+    int malformed_flag = 0;
+    long record_line = 0;
+
+    char *line;
+    size_t length;
+    while ((line = read_line(reader, &length)) != NULL) {
+        if (!in_record) {
+            if (is_blank_line(line, length)) {
+                continue;
+            }
+            if (!header_checked) {
+                header_checked = 1;
+                if (csv_parse_header(line, column_fields, field_columns)) {
+                    continue;
+                }
+            }
+            draft_reset(&draft);
+            state = CSV_FIELD_START;
+            column = 0;
+            in_record = 1;
+            malformed_flag = 0;
+            record_line = reader->line_number;
+        } else {
+            // A quoted field spans lines, the line break belongs to its value
+            if (column < CSV_MAX_COLUMNS && column_fields[column] >= 0) {
+                field_append(&draft.fields[column_fields[column]], '\n');
+            }
+        }
+
+        for (size_t i = 0; i < length; ++i) {
+            char c = line[i];
+            int store_flag = 0;
+            switch (state) {
+                case CSV_FIELD_START:
+                    if (c == '"') {
+                        state = CSV_QUOTED;
+                    } else if (c == ',') {
+                        column++;
+                    } else {
+                        store_flag = 1;
+                        state = CSV_UNQUOTED;
+                    }
+                    break;
+                case CSV_UNQUOTED:
+                    if (c == ',') {
+                        column++;
+                        state = CSV_FIELD_START;
+                    } else {
+                        store_flag = 1;
+                    }
+                    break;
+                case CSV_QUOTED:
+                    if (c == '"') {
+                        state = CSV_QUOTE_IN_QUOTED;
+                    } else {
+                        store_flag = 1;
+                    }
+                    break;
+                case CSV_QUOTE_IN_QUOTED:
+                    if (c == '"') {
+                        store_flag = 1;
+                        state = CSV_QUOTED;
+                    } else if (c == ',') {
+                        column++;
+                        state = CSV_FIELD_START;
+                    } else {
+                        malformed_flag = 1;
+                        store_flag = 1;
+                        state = CSV_UNQUOTED;
+                    }
+                    break;
+            }
+            if (store_flag && column < CSV_MAX_COLUMNS && column_fields[column] >= 0) {
+                field_append(&draft.fields[column_fields[column]], c);
+            }
+        }
+        if (state == CSV_QUOTED) {
+            continue;
+        }
+
+        in_record = 0;
+        if (malformed_flag) {
+            report_rejected(target, record_line, "malformed quoted field");
+            continue;
+        }
+        for (int i = 0; i < FIELD_COUNT; ++i) {
+            draft.fields[i].present_flag = field_columns[i] <= column;
+        }
+        if (submit_draft(target, &draft, record_line)) {
+            return;
+        }
+    }
+
+    if (in_record) {
+        report_rejected(target, record_line, "unterminated quoted field");
+    }
+}
+
+// ==================
+// = vCard importer =
+// ==================
+
+typedef enum {
+    VCARD_IGNORED,
+    VCARD_BEGIN,
+    VCARD_END,
+    VCARD_FN,
+    VCARD_N,
+    VCARD_TEL,
+    VCARD_EMAIL
+} VcardProperty;
+
+typedef struct {
+    ContactDraft draft;
+    char n_name_data[MAX_NAMELEN + 1];
+    FieldBuffer n_name; // name composed from the N property, used if the card has no FN
+    int in_card;
+    long card_line;
+
+    // The current property, unfolded from its continuation lines
+    char property[VCARD_PROPERTY_MAXLEN + 1];
+    int property_length;
+    int property_overflow_flag;
+    int property_nul_flag; // the property lines contain a raw NUL byte, which ends the buffered string early
+    VcardProperty property_type;
+} VcardParser;
+
+static VcardProperty vcard_property_type(const char *line) {
+    // The name ends at the first parameter or at the value, and may be prefixed with a group ("item1.EMAIL")
+    size_t name_length = strcspn(line, ";:");
+    const char *name = line;
+    for (size_t i = 0; i < name_length; ++i) {
+        if (line[i] == '.') {
+            name = line + i + 1;
+        }
+    }
+    name_length -= name - line;
+
+    static const struct {
+        const char *name;
+        VcardProperty type;
+    } known_properties[] = {
+            {"BEGIN", VCARD_BEGIN},
+            {"END",   VCARD_END},
+            {"FN",    VCARD_FN},
+            {"N",     VCARD_N},
+            {"TEL",   VCARD_TEL},
+            {"EMAIL", VCARD_EMAIL}
+    };
+    for (size_t i = 0; i < sizeof(known_properties) / sizeof(known_properties[0]); ++i) {
+        if (strlen(known_properties[i].name) == name_length &&
+            strncasecmp(name, known_properties[i].name, name_length) == 0) {
+            return known_properties[i].type;
+        }
+    }
+    return VCARD_IGNORED;
+}
+
+// Unescapes a text value into the field, stopping at the end of the value or (if requested) at a component separator.
+// Returns a pointer to the separator or the end of the value
+static const char *vcard_unescape(const char *value, FieldBuffer *field, int stop_at_semicolon) {
+    for (; *value != '\0'; ++value) {
+        if (*value == ';' && stop_at_semicolon) {
+            break;
+        }
+        if (*value == '\\' && value[1] != '\0') {
+            value++;
+            field_append(field, (*value == 'n' || *value == 'N') ? '\n' : *value);
+        } else {
+            field_append(field, *value);
+        }
+    }
+    return value;
+}
+
+static void vcard_set_field(FieldBuffer *field, const char *value, int overflow_flag, int nul_flag) {
+    if (field->present_flag) {
+        return; // only the first occurrence of the property is used
+    }
+    field->present_flag = 1;
+    vcard_unescape(value, field, 0);
+    field->overflow_flag |= overflow_flag;
+    field->nul_flag |= nul_flag;
+}
+
+// N is structured as "family;given;additional;prefixes;suffixes", the name is composed as "given family"
+static void vcard_set_n_name(VcardParser *parser, const char *value) {
+    if (parser->n_name.present_flag) {
+        return;
+    }
+
+    char family_data[MAX_NAMELEN + 1];
+    FieldBuffer family;
+    field_init(&family, family_data, MAX_NAMELEN);
+    const char *given = vcard_unescape(value, &family, 1);
+
+    FieldBuffer *n_name = &parser->n_name;
+    if (*given == ';') {
+        vcard_unescape(given + 1, n_name, 1);
+    }
+    if (n_name->length > 0 && family.length > 0) {
+        field_append(n_name, ' ');
+    }
+    for (int i = 0; i < family.length; ++i) {
+        field_append(n_name, family.data[i]);
+    }
+    n_name->overflow_flag |= family.overflow_flag || parser->property_overflow_flag;
+    n_name->nul_flag |= family.nul_flag || parser->property_nul_flag;
+    n_name->present_flag = 1;
+}
+
+static int vcard_finish_card(VcardParser *parser, ImportTarget *target) {
+    parser->in_card = 0;
+    FieldBuffer *name = &parser->draft.fields[FIELD_NAME];
+    if (!name->present_flag && parser->n_name.present_flag) {
+        strcpy(name->data, parser->n_name.data);
+        name->length = parser->n_name.length;
+        name->overflow_flag = parser->n_name.overflow_flag;
+        name->nul_flag = parser->n_name.nul_flag;
+        name->present_flag = 1;
+    }
+    return submit_draft(target, &parser->draft, parser->card_line);
+}
+
+// Processes the unfolded property. Returns 1 if the import cannot continue
+static int vcard_process_property(VcardParser *parser, ImportTarget *target, long line_number) {
+    VcardProperty type = parser->property_type;
+    parser->property_type = VCARD_IGNORED;
+    if (type == VCARD_IGNORED) {
+        return 0;
+    }
+
+    // The value starts after the first colon, which is not a part of a quoted parameter value
+    char *value = parser->property;
+    int in_quotes = 0;
+    for (; *value != '\0' && (in_quotes || *value != ':'); ++value) {
+        if (*value == '"') {
+            in_quotes = !in_quotes;
+        }
+    }
+    if (*value == '\0') {
+        return 0; // not a property line
+    }
+    value++;
+
+    if (type == VCARD_BEGIN) {
+        if (strcasecmp(value, "VCARD") != 0) {
+            return 0;
+        }
+        if (parser->in_card) {
+            report_rejected(target, parser->card_line, "card is not terminated with END:VCARD");
+        }
+        draft_reset(&parser->draft);
+        field_init(&parser->n_name, parser->n_name_data, MAX_NAMELEN);
+        parser->in_card = 1;
+        parser->card_line = line_number;
+        return 0;
+    }
+    if (!parser->in_card) {
+        return 0;
+    }
+
+    ContactDraft *draft = &parser->draft;
+    switch (type) {
+        case VCARD_END:
+            if (strcasecmp(value, "VCARD") == 0) {
+                return vcard_finish_card(parser, target);
+            }
+            break;
+        case VCARD_FN:
+            vcard_set_field(&draft->fields[FIELD_NAME], value, parser->property_overflow_flag,
+                            parser->property_nul_flag);
+            break;
+        case VCARD_N:
+            vcard_set_n_name(parser, value);
+            break;
+        case VCARD_TEL:
+            // vCard 4.0 writes phone numbers as URIs by default
+            if (strncasecmp(value, "tel:", 4) == 0) {
+                value += 4;
+            }
+            vcard_set_field(&draft->fields[FIELD_PHONE], value, parser->property_overflow_flag,
+                            parser->property_nul_flag);
+            break;
+        case VCARD_EMAIL:
+            vcard_set_field(&draft->fields[FIELD_EMAIL], value, parser->property_overflow_flag,
+                            parser->property_nul_flag);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void import_vcard(LineReader *reader, ImportTarget *target) {
+    VcardParser parser;
+    parser.in_card = 0;
+    parser.card_line = 0;
+    parser.property_type = VCARD_IGNORED;
+    long property_line = 0;
+
+    char *line;
+    size_t length;
+    while ((line = read_line(reader, &length)) != NULL) {
+        // Long lines are folded by inserting a line break followed by a single space or tab
+        if (line[0] == ' ' || line[0] == '\t') {
+            if (parser.property_type != VCARD_IGNORED) {
+                size_t append_length = length - 1;
+                if (parser.property_length + append_length > VCARD_PROPERTY_MAXLEN) {
+                    append_length = VCARD_PROPERTY_MAXLEN - parser.property_length;
+                    parser.property_overflow_flag = 1;
+                }
+                parser.property_nul_flag |= memchr(line, '\0', length) != NULL;
+                memcpy(parser.property + parser.property_length, line + 1, append_length);
+                parser.property_length += (int) append_length;
+                parser.property[parser.property_length] = '\0';
+            }
+            continue;
+        }
+
+        if (vcard_process_property(&parser, target, property_line)) {
+            return;
+        }
+
+        // Only the properties used by the contacts are buffered, the rest (e.g. inline photos) is skipped
+        parser.property_type = vcard_property_type(line);
+        if (parser.property_type != VCARD_IGNORED) {
+            size_t copy_length = length;
+            parser.property_overflow_flag = 0;
+            parser.property_nul_flag = memchr(line, '\0', length) != NULL;
+            if (copy_length > VCARD_PROPERTY_MAXLEN) {
+                copy_length = VCARD_PROPERTY_MAXLEN;
+                parser.property_overflow_flag = 1;
+            }
+            memcpy(parser.property, line, copy_length);
+            parser.property[copy_length] = '\0';
+            parser.property_length = (int) copy_length;
+            property_line = reader->line_number;
+        }
+    }
+
+    if (vcard_process_property(&parser, target, property_line)) {
+        return;
+    }
+    if (parser.in_card) {
+        report_rejected(target, parser.card_line, "card is not terminated with END:VCARD");
+    }
+}
+
+// =======================
+// = JSON Lines importer =
+// =======================
+
+static void json_skip_whitespace(const char **cursor) {
+    while (**cursor == ' ' || **cursor == '\t' || **cursor == '\r') {
+        (*cursor)++;
+    }
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int json_parse_hex4(const char *digits, unsigned int *code_unit) {
+    *code_unit = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hex_digit_value(digits[i]);
+        if (digit < 0) {
+            return 1;
+        }
+        *code_unit = *code_unit * 16 + (unsigned int) digit;
+    }
+    return 0;
+}
+
+static void field_append_utf8(FieldBuffer *field, unsigned int code_point) {
+    if (code_point < 0x80) {
+        field_append(field, (char) code_point);
+    } else if (code_point < 0x800) {
+        field_append(field, (char) (0xC0 | (code_point >> 6)));
+        field_append(field, (char) (0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        field_append(field, (char) (0xE0 | (code_point >> 12)));
+        field_append(field, (char) (0x80 | ((code_point >> 6) & 0x3F)));
+        field_append(field, (char) (0x80 | (code_point & 0x3F)));
+    } else {
+        field_append(field, (char) (0xF0 | (code_point >> 18)));
+        field_append(field, (char) (0x80 | ((code_point >> 12) & 0x3F)));
+        field_append(field, (char) (0x80 | ((code_point >> 6) & 0x3F)));
+        field_append(field, (char) (0x80 | (code_point & 0x3F)));
+    }
+}
+
+// Parses a string starting at the opening quote. The value is decoded into the field, or skipped if it is NULL.
+// Returns 0 on success, 1 if the string is malformed
+static int json_parse_string(const char **cursor, FieldBuffer *field) {
+    const char *c = *cursor + 1;
+    while (*c != '"') {
+        if ((unsigned char) *c < 0x20) {
+            return 1; // unterminated string or a raw control character
+        }
+        if (*c != '\\') {
+            if (field != NULL) {
+                field_append(field, *c);
+            }
+            c++;
+            continue;
+        }
+
+        char decoded;
+        c++;
+        switch (*c) {
+            case '"':
+            case '\\':
+            case '/':
+                decoded = *c;
+                break;
+            case 'b':
+                decoded = '\b';
+                break;
+            case 'f':
+                decoded = '\f';
+                break;
+            case 'n':
+                decoded = '\n';
+                break;
+            case 'r':
+                decoded = '\r';
+                break;
+            case 't':
+                decoded = '\t';
+                break;
+            case 'u': {
+                unsigned int code_point;
+                if (json_parse_hex4(c + 1, &code_point)) {
+                    return 1;
+                }
+                c += 5;
+                unsigned int low_surrogate;
+                if (code_point >= 0xD800 && code_point <= 0xDBFF &&
+                    c[0] == '\\' && c[1] == 'u' && !json_parse_hex4(c + 2, &low_surrogate) &&
+                    low_surrogate >= 0xDC00 && low_surrogate <= 0xDFFF) {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                    c += 6;
+                } else if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+                    code_point = 0xFFFD; // unpaired surrogate
+                }
+                if (field != NULL) {
+                    field_append_utf8(field, code_point);
+                }
+                continue;
+            }
+            default:
+                return 1;
+        }
+        if (field != NULL) {
+            field_append(field, decoded);
+        }
+        c++;
+    }
+    *cursor = c + 1;
+    return 0;
+}
+
+// Skips any value. Nested objects and arrays are only checked for balanced brackets
+static int json_skip_value(const char **cursor) {
+    const char *c = *cursor;
+    if (*c == '"') {
+        return json_parse_string(cursor, NULL);
+    }
+    if (*c == '{' || *c == '[') {
+        int depth = 0;
+        do {
+            if (*c == '"') {
+                if (json_parse_string(&c, NULL)) {
+                    return 1;
+                }
+                continue;
+            }
+            if (*c == '\0') {
+                return 1;
+            }
+            if (*c == '{' || *c == '[') {
+                depth++;
+            } else if (*c == '}' || *c == ']') {
+                depth--;
+            }
+            c++;
+        } while (depth > 0);
+        *cursor = c;
+        return 0;
+    }
+
+    // Numbers and literals
+    const char *start = c;
+    while (*c != '\0' && strchr(",}] \t", *c) == NULL) {
+        c++;
+    }
+    *cursor = c;
+    return c == start;
+}
+
+static int import_jsonl_record(const char *line, ContactDraft *draft, ImportTarget *target, long line_number) {
+    const char *c = line;
+    json_skip_whitespace(&c);
+    if (*c != '{') {
+        report_rejected(target, line_number, "line is not a JSON object");
+        return 0;
+    }
+    c++;
+    json_skip_whitespace(&c);
+
+    draft_reset(draft);
+    int closed_flag = *c == '}';
+    if (closed_flag) {
+        c++;
+    }
+    while (!closed_flag) {
+        char key_data[JSON_KEY_MAXLEN + 1];
+        FieldBuffer key;
+        field_init(&key, key_data, JSON_KEY_MAXLEN);
+        if (*c != '"' || json_parse_string(&c, &key)) {
+            break;
+        }
+        json_skip_whitespace(&c);
+        if (*c != ':') {
+            break;
+        }
+        c++;
+        json_skip_whitespace(&c);
+
+        int field_id = -1;
+        for (int i = 0; i < FIELD_COUNT && !key.overflow_flag; ++i) {
+            if (strcmp(key.data, field_labels[i]) == 0) {
+                field_id = i;
+            }
+        }
+        if (field_id >= 0) {
+            if (*c != '"') {
+                report_rejected(target, line_number, "%s is not a string", field_labels[field_id]);
+                return 0;
+            }
+            // The last occurrence of a duplicate key wins, as in most JSON parsers
+            FieldBuffer *field = &draft->fields[field_id];
+            field_clear(field);
+            field->present_flag = 1;
+            if (json_parse_string(&c, field)) {
+                break;
+            }
+        } else if (json_skip_value(&c)) {
+            break;
+        }
+
+        json_skip_whitespace(&c);
+        if (*c == ',') {
+            c++;
+            json_skip_whitespace(&c);
+        } else if (*c == '}') {
+            c++;
+            closed_flag = 1;
+        } else {
+            break;
+        }
+    }
+
+    json_skip_whitespace(&c);
+    if (!closed_flag || *c != '\0') {
+        report_rejected(target, line_number, "malformed JSON object");
+        return 0;
+    }
+    return submit_draft(target, draft, line_number);
+}
+
+static void import_jsonl(LineReader *reader, ImportTarget *target) {
+    ContactDraft draft;
+    char *line;
+    size_t length;
+    while ((line = read_line(reader, &length)) != NULL) {
+        if (is_blank_line(line, length)) {
+            continue;
+        }
+        // The parser works on the C string, which a raw NUL byte would end early
+        if (memchr(line, '\0', length) != NULL) {
+            report_rejected(target, reader->line_number, "line contains a NUL character");
+            continue;
+        }
+        if (import_jsonl_record(line, &draft, target, reader->line_number)) {
+            return;
+        }
+    }
+}
+
+// ================
+// = Import entry =
+// ================
+
+static void import_records(LineReader *reader, ImportTarget *target, ContactFormat format) {
+    switch (format) {
+        case CONTACT_FORMAT_CSV:
+            import_csv(reader, target);
+            break;
+        case CONTACT_FORMAT_VCARD3:
+        case CONTACT_FORMAT_VCARD4:
+            import_vcard(reader, target);
+            break;
+        case CONTACT_FORMAT_JSONL:
+            import_jsonl(reader, target);
+            break;
+        default:
+            target->report.error_flag = 1;
+            break;
+    }
+    if (reader->error_flag) {
+        report_fatal(target, reader->line_number + 1, "Failed to read the input");
+    }
+}
+
+Contact *import_contacts_from_stream(Contact *database, int *contact_count, FILE *input, const char *source_name,
+                                     ContactFormat format, ImportReport *report) {
+    ImportTarget target;
+    memset(&target, 0, sizeof(ImportTarget));
+    target.source_name = source_name != NULL ? source_name : "input";
+
+    LineReader reader;
+    if (contact_count == NULL || input == NULL || line_reader_init(&reader, input)) {
+        target.report.error_flag = 1;
+        if (report != NULL) {
+            *report = target.report;
+        }
+        return database;
+    }
+
+    target.database = database;
+    target.count = *contact_count;
+    target.capacity = *contact_count;
+    if (index_reserve(&target, target.count)) {
+        report_fatal(&target, 0, "Failed to allocate memory for the name index");
+    } else {
+        import_records(&reader, &target, format);
+    }
+
+    // Give back the memory reserved for further growth
+    if (target.count > 0 && target.count < target.capacity) {
+        Contact *shrunk_database = realloc(target.database, sizeof(Contact) * target.count);
+        if (shrunk_database != NULL) {
+            target.database = shrunk_database;
+        }
+    }
+
+    free(target.name_index);
+    free(reader.buffer);
+    *contact_count = target.count;
+    if (report != NULL) {
+        *report = target.report;
+    }
+    return target.database;
+}
+
+Contact *import_contacts(Contact *database, int *contact_count, const char *input_file, ContactFormat format,
+                         ImportReport *report) {
+    FILE *file = input_file != NULL ? fopen(input_file, "rb") : NULL;
+    if (file == NULL) {
+        if (input_file != NULL) {
+            fprintf(stderr, "Failed to open the file, when importing contacts: %s\n", input_file);
+        }
+        if (report != NULL) {
+            memset(report, 0, sizeof(ImportReport));
+            report->error_flag = 1;
+        }
+        return database;
+    }
+
+    database = import_contacts_from_stream(database, contact_count, file, input_file, format, report);
+    fclose(file);
+    return database;
+}
+
+ContactStatus contact_db_import_from_stream(ContactDB *db, FILE *input, const char *source_name, ContactFormat format,
+                                            ImportReport *report) {
+    ImportTarget target;
+    memset(&target, 0, sizeof(ImportTarget));
+    target.db = db;
+    target.db_status = CONTACT_OK;
+    target.source_name = source_name != NULL ? source_name : "input";
+
+    ContactStatus status = CONTACT_OK;
+    LineReader reader;
+    if (db == NULL || input == NULL || format < CONTACT_FORMAT_CSV || format > CONTACT_FORMAT_JSONL) {
+        status = CONTACT_ERR_INVALID;
+    } else if (line_reader_init(&reader, input)) {
+        status = CONTACT_ERR_NO_MEMORY;
+    } else {
+        import_records(&reader, &target, format);
+        if (reader.error_flag) {
+            status = CONTACT_ERR_IO;
+        } else if (target.report.error_flag) {
+            status = target.db_status;
+        }
+        free(reader.buffer);
+    }
+
+    if (status != CONTACT_OK) {
+        target.report.error_flag = 1;
+    }
+    if (report != NULL) {
+        *report = target.report;
+    }
+    return status;
+}
+
+ContactStatus contact_db_import(ContactDB *db, const char *input_file, ContactFormat format, ImportReport *report) {
+    if (db == NULL || input_file == NULL) {
+        if (report != NULL) {
+            memset(report, 0, sizeof(ImportReport));
+            report->error_flag = 1;
+        }
+        return CONTACT_ERR_INVALID;
+    }
+    FILE *file = fopen(input_file, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open the file, when importing contacts: %s\n", input_file);
+        if (report != NULL) {
+            memset(report, 0, sizeof(ImportReport));
+            report->error_flag = 1;
+        }
+        return CONTACT_ERR_IO;
+    }
+
+    ContactStatus status = contact_db_import_from_stream(db, file, input_file, format, report);
+    fclose(file);
+    return status;
+}
+
+// =============
+// = Exporters =
+// =============
+
+static void export_csv_field(FILE *output, const char *value) {
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        fputs(value, output);
+        return;
+    }
+
+    fputc('"', output);
+    for (; *value != '\0'; ++value) {
+        if (*value == '"') {
+            fputc('"', output);
+        }
+        fputc(*value, output);
+    }
+    fputc('"', output);
+}
+
+static void export_csv_contact(FILE *output, const Contact *contact) {
+    export_csv_field(output, contact->name);
+    fputc(',', output);
+    export_csv_field(output, contact->phone);
+    fputc(',', output);
+    export_csv_field(output, contact->email);
+    fputs("\r\n", output);
+}
+
+// Escapes the text value and appends it to the property line
+static size_t vcard_escape(char *line, size_t length, const char *value) {
+    for (; *value != '\0'; ++value) {
+        if (*value == '\\' || *value == ',' || *value == ';') {
+            line[length++] = '\\';
+        }
+        line[length++] = *value;
+    }
+    line[length] = '\0';
+    return length;
+}
+
+// Writes the property line, folded after every 75 octets without splitting multibyte UTF-8 characters
+static void export_vcard_line(FILE *output, const char *line, size_t length) {
+    size_t written = 0;
+    size_t width = VCARD_FOLD_WIDTH;
+    while (length - written > width) {
+        size_t chunk = width;
+        while (chunk > 1 && ((unsigned char) line[written + chunk] & 0xC0) == 0x80) {
+            chunk--;
+        }
+        fwrite(line + written, 1, chunk, output);
+        fputs("\r\n ", output);
+        written += chunk;
+        width = VCARD_FOLD_WIDTH - 1; // the leading space counts towards the limit
+    }
+    fwrite(line + written, 1, length - written, output);
+    fputs("\r\n", output);
+}
+
+static void export_vcard_property(FILE *output, const char *prefix, const char *value, const char *suffix) {
+    // Every character of the value is escaped at most once, the prefix and suffix are short constants
+    char line[2 * MAX_NAMELEN + 64];
+    size_t length = strlen(prefix);
+    memcpy(line, prefix, length);
+    length = vcard_escape(line, length, value);
+    strcpy(line + length, suffix);
+    length += strlen(suffix);
+    export_vcard_line(output, line, length);
+}
+
+static void export_vcard_contact(FILE *output, const Contact *contact, int version_4_flag) {
+    fputs("BEGIN:VCARD\r\n", output);
+    if (version_4_flag) {
+        fputs("VERSION:4.0\r\n", output);
+        export_vcard_property(output, "FN:", contact->name, "");
+        export_vcard_property(output, "TEL;VALUE=text:", contact->phone, "");
+        export_vcard_property(output, "EMAIL:", contact->email, "");
+    } else {
+        // N is required in vCard 3.0, the whole name is stored as the family name
+        fputs("VERSION:3.0\r\n", output);
+        export_vcard_property(output, "N:", contact->name, ";;;;");
+        export_vcard_property(output, "FN:", contact->name, "");
+        export_vcard_property(output, "TEL;TYPE=VOICE:", contact->phone, "");
+        export_vcard_property(output, "EMAIL;TYPE=INTERNET:", contact->email, "");
+    }
+    fputs("END:VCARD\r\n", output);
+}
+
+static void export_json_string(FILE *output, const char *value) {
+    fputc('"', output);
+    for (; *value != '\0'; ++value) {
+        unsigned char c = (unsigned char) *value;
+        if (c == '"' || c == '\\') {
+            fputc('\\', output);
+            fputc(c, output);
+        } else if (c < 0x20) {
+            fprintf(output, "\\u%04x", c);
+        } else {
+            fputc(c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+static void export_jsonl_contact(FILE *output, const Contact *contact) {
+    fputs("{\"name\":", output);
+    export_json_string(output, contact->name);
+    fputs(",\"phone\":", output);
+    export_json_string(output, contact->phone);
+    fputs(",\"email\":", output);
+    export_json_string(output, contact->email);
+    fputs("}\n", output);
+}
+
+// The contacts to export, either an array of contacts or the array of pointers of a ContactDB
+typedef struct {
+    const Contact *database;
+    Contact *const *contacts;
+    int count;
+} ExportSource;
+
+static int export_source_to_stream(const ExportSource *source, FILE *output, ContactFormat format) {
+    if (format < CONTACT_FORMAT_CSV || format > CONTACT_FORMAT_JSONL) {
+        return 1;
+    }
+
+    if (format == CONTACT_FORMAT_CSV) {
+        fputs("name,phone,email\r\n", output);
+    }
+    for (int i = 0; i < source->count; ++i) {
+        const Contact *contact = source->database != NULL ? &source->database[i] : source->contacts[i];
+        switch (format) {
+            case CONTACT_FORMAT_CSV:
+                export_csv_contact(output, contact);
+                break;
+            case CONTACT_FORMAT_VCARD3:
+                export_vcard_contact(output, contact, 0);
+                break;
+            case CONTACT_FORMAT_VCARD4:
+                export_vcard_contact(output, contact, 1);
+                break;
+            case CONTACT_FORMAT_JSONL:
+                export_jsonl_contact(output, contact);
+                break;
+        }
+    }
+
+    return ferror(output) != 0;
+}
+
+static int export_source_to_file(const ExportSource *source, const char *output_file, ContactFormat format) {
+    FILE *file = output_file != NULL ? fopen(output_file, "wb") : NULL;
+    if (file == NULL) {
+        if (output_file != NULL) {
+            fprintf(stderr, "Failed to open the file to export contacts: %s\n", output_file);
+        }
+        return 1;
+    }
+    setvbuf(file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+
+    int error_flag = export_source_to_stream(source, file, format);
+    if (fclose(file) != 0 || error_flag) {
+        fprintf(stderr, "Failed to export contacts to the file: %s\n", output_file);
+        return 1;
+    }
+    return 0;
+}
+
+int export_contacts_to_stream(const Contact *database, int contact_count, FILE *output, ContactFormat format) {
+    if (output == NULL ||
+        contact_count < 0 ||
+        (database == NULL && contact_count > 0)) {
+        return 1;
+    }
+    ExportSource source = {database, NULL, contact_count};
+    return export_source_to_stream(&source, output, format);
+}
+
+int export_contacts(const Contact *database, int contact_count, const char *output_file, ContactFormat format) {
+    // Check the arguments before the file is truncated
+    if (contact_count < 0 || (database == NULL && contact_count > 0)) {
+        return 1;
+    }
+    ExportSource source = {database, NULL, contact_count};
+    return export_source_to_file(&source, output_file, format);
+}
+
+int contact_db_export_to_stream(const ContactDB *db, FILE *output, ContactFormat format) {
+    if (db == NULL || output == NULL) {
+        return 1;
+    }
+    ExportSource source = {NULL, db->contacts, db->count};
+    return export_source_to_stream(&source, output, format);
+}
+
+int contact_db_export(const ContactDB *db, const char *output_file, ContactFormat format) {
+    if (db == NULL) {
+        return 1;
+    }
+    ExportSource source = {NULL, db->contacts, db->count};
+    return export_source_to_file(&source, output_file, format);
+}
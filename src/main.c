@@ -1,12 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "contacts.h"
+#include "change_stream.h"
+#include "contact_db.h"
+#include "persistence.h"
 
 #define ZERO_ASCII 48
 #define NUM_OF_ACTIONS 5
 
 const char *contact_list_file = "contact_db.txt";
+// Edits are saved in the background, at most this many milliseconds after they were made
+const int autosave_interval_ms = 2000;
+// Every change of the contacts is streamed to the replicas connected to this socket
+const char *change_feed_socket = "contact_db.sock";
+const size_t change_feed_capacity = 1 << 12;
 
 typedef enum {
     START_SCREEN,
@@ -75,6 +82,14 @@ static void display_menu() {
     printf("5. Save and Exit\n");
 }
 
+static void list_database(const ContactDB *database) {
+    for (int i = 0; i < database->count; ++i) {
+        printf("Contact #%d:\n", i + 1);
+        print_contact(*database->contacts[i]);
+        printf("\n");
+    }
+}
+
 static int handle_start_screen() {
     display_menu();
     printf("Choose an option: ");
@@ -92,10 +107,23 @@ static int handle_start_screen() {
 }
 
 int main(void) {
-    Contact *database = NULL;
-    int contact_count = 0;
+    ContactDB database;
+    contact_db_init(&database, NULL);
 
-    database = load_contacts_from_file(database, &contact_count, contact_list_file);
+    // The feed is attached before loading, so that the loaded contacts are streamed like any other change
+    // (a replica whose events are no longer in the ring receives a snapshot of the contacts instead)
+    ChangeFeed *feed = change_feed_create(change_feed_capacity);
+    contact_db_attach_feed(&database, feed);
+
+    ContactStatus load_status = contact_db_load_from_file(&database, contact_list_file);
+    if (load_status != CONTACT_OK) {
+        printf("Failed to load all contacts: %s\n\n", contact_status_message(load_status));
+    }
+
+    // If the persistence thread cannot be started, the contacts are still saved synchronously on exit
+    Persister *persister = persister_start(contact_list_file, autosave_interval_ms);
+    // Without a feed server the contacts are managed the same way, they are just not replicated
+    ChangeFeedServer *feed_server = feed != NULL ? change_feed_serve(&database, change_feed_socket) : NULL;
 
     ActionState action_state = START_SCREEN;
     int exit_flag = 0;
@@ -124,7 +152,7 @@ int main(void) {
                     break;
                 }
                 // Check if the inputted name is unique in the database
-                if (search_contact(name, database, contact_count) != NULL) {
+                if (contact_db_search(&database, name) != NULL) {
                     printf("Contact with such name already exists in the database!\n\n");
                     strcpy(name, "");
                     break;
@@ -140,12 +168,12 @@ int main(void) {
                     break;
                 }
 
-                Contact *updated_database = add_contact(name, phone, email, database, &contact_count);
-                if (updated_database == NULL) {
-                    printf("Failed to add %s to database! Try rechecking the input data.\n\n", name);
+                ContactStatus status = contact_db_add(&database, name, phone, email);
+                if (status != CONTACT_OK) {
+                    printf("Failed to add %s to database! %s.\n\n", name, contact_status_message(status));
                 } else {
                     printf("Successfully added %s to database!\n\n", name);
-                    database = updated_database;
+                    persister_submit_db(persister, &database);
                 }
 
                 strcpy(name, "");
@@ -161,7 +189,7 @@ int main(void) {
                     break;
                 }
 
-                Contact *found_contact = search_contact(name, database, contact_count);
+                Contact *found_contact = contact_db_search(&database, name);
                 if (found_contact == NULL) {
                     printf("Contact with the name %s was not found!\n\n", name);
                 } else {
@@ -177,7 +205,7 @@ int main(void) {
                 break;
             }
             case DELETE_CONTACT: {
-                if (contact_count == 0) {
+                if (database.count == 0) {
                     printf("Contact list is empty, nothing to delete!\n\n");
                     action_state = START_SCREEN;
                     break;
@@ -189,14 +217,14 @@ int main(void) {
                     break;
                 }
 
-                Contact *updated_database = delete_contact(name, database, &contact_count);
-                // For the error, we additionally check if contact_count > 0,
-                // as the delete_contact will return NULL if the contact count was 1 before deletion,
-                // but such NULL is not an error - it is expected as the database becomes empty
-                if (updated_database == NULL && contact_count > 0) {
+                ContactStatus status = contact_db_delete(&database, name);
+                if (status == CONTACT_ERR_NOT_FOUND) {
                     printf("There is no contact with name %s in the contact list!\n\n", name);
+                } else if (status != CONTACT_OK) {
+                    printf("Failed to delete %s! %s.\n\n", name, contact_status_message(status));
                 } else {
                     printf("Contact with the name %s was deleted successfully!\n\n", name);
+                    persister_submit_db(persister, &database);
                 }
 
                 strcpy(name, "");
@@ -204,8 +232,8 @@ int main(void) {
                 break;
             }
             case LIST_CONTACTS: {
-                list_contacts(database, contact_count);
-                printf("Total number of contacts: %d\n\n", contact_count);
+                list_database(&database);
+                printf("Total number of contacts: %d\n\n", database.count);
                 wait_for_enter();
                 clear_screen();
 
@@ -213,7 +241,17 @@ int main(void) {
                 break;
             }
             case SAVE_AND_EXIT: {
-                save_contacts_to_file(database, contact_count, contact_list_file);
+                int error_flag;
+                if (persister != NULL) {
+                    error_flag = persister_submit_db(persister, &database);
+                    error_flag |= persister_stop(persister);
+                    persister = NULL;
+                } else {
+                    error_flag = contact_db_save_to_file(&database, contact_list_file);
+                }
+                if (error_flag) {
+                    printf("Failed to save the contacts to %s, the latest changes were lost!\n", contact_list_file);
+                }
 
                 exit_flag = 1;
                 break;
@@ -221,6 +259,8 @@ int main(void) {
         }
     }
 
-    free(database);
+    change_feed_server_stop(feed_server);
+    contact_db_free(&database);
+    change_feed_destroy(feed);
     return 0;
 }
@@ -0,0 +1,339 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "persistence.h"
+
+struct Persister {
+    char *output_file;
+    char *temp_file;
+    char *directory; // the directory of the output file, synced after the rename
+    long long autosave_interval_ms;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond; // signals the I/O thread (new snapshot, flush request or stop)
+    pthread_cond_t done_cond; // signals the waiters in persister_flush
+
+    // The pending snapshot is filled by persister_submit, and swapped with the writing buffer by the I/O thread,
+    // so both buffers are reused and the lock is never held during the actual file write
+    Contact *pending;
+    int pending_count;
+    int pending_capacity;
+    Contact *writing;
+    int writing_capacity;
+
+    // Saves are counted, so that persister_flush and persister_stop can wait for one that starts after them
+    unsigned long long started_saves;
+    unsigned long long finished_saves; // successful or not
+    unsigned long long requested_saves; // the save that persister_flush or persister_stop waits for
+    int pending_dirty;
+    long long dirty_since_ms; // time of the first submission that went into the pending snapshot
+    int stop_flag;
+    int last_error;
+};
+
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static struct timespec ms_to_timespec(long long ms) {
+    struct timespec result;
+    result.tv_sec = (time_t) (ms / 1000);
+    result.tv_nsec = (long) (ms % 1000) * 1000000;
+    return result;
+}
+
+// Writes the contacts in the format of save_contacts_to_file, and makes sure they reached the disk before returning
+static int write_durable_file(const Contact *snapshot, int snapshot_count, const char *output_file) {
+    FILE *file = fopen(output_file, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open the file to save contacts: %s\n", output_file);
+        return 1;
+    }
+
+    for (int i = 0; i < snapshot_count; ++i) {
+        fprintf(file, "%s\n", snapshot[i].name);
+        fprintf(file, "%s\n", snapshot[i].phone);
+        fprintf(file, "%s\n", snapshot[i].email);
+    }
+
+    // Without the fsync, a crash shortly after the rename could leave the new name pointing at an empty file
+    int error_flag = fflush(file) != 0 || ferror(file) || fsync(fileno(file)) != 0;
+    if (fclose(file) != 0 || error_flag) {
+        fprintf(stderr, "Failed to write contacts to the file: %s\n", output_file);
+        return 1;
+    }
+    return 0;
+}
+
+// Syncs the directory, so that the rename of the file in it survives a crash as well
+static int sync_directory(const char *directory) {
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return 1;
+    }
+    int error_flag = fsync(fd) != 0;
+    close(fd);
+    return error_flag;
+}
+
+// Writes the snapshot next to the output file first, so the old file is replaced only by a complete new one
+static int write_snapshot(Persister *persister, Contact *snapshot, int snapshot_count) {
+    if (write_durable_file(snapshot, snapshot_count, persister->temp_file)) {
+        remove(persister->temp_file);
+        return 1;
+    }
+    if (rename(persister->temp_file, persister->output_file) != 0) {
+        fprintf(stderr, "Failed to replace the file with the saved contacts: %s\n", persister->output_file);
+        remove(persister->temp_file);
+        return 1;
+    }
+    if (sync_directory(persister->directory)) {
+        fprintf(stderr, "Failed to sync the directory of the saved contacts: %s\n", persister->directory);
+        return 1;
+    }
+    return 0;
+}
+
+static void *persister_thread(void *arg) {
+    Persister *persister = arg;
+
+    pthread_mutex_lock(&persister->lock);
+    while (1) {
+        // When stopping, the thread exits after the save persister_stop asked for, even if it failed
+        if (!persister->pending_dirty ||
+            (persister->stop_flag && persister->started_saves >= persister->requested_saves)) {
+            if (persister->stop_flag) {
+                break;
+            }
+            pthread_cond_wait(&persister->work_cond, &persister->lock);
+            continue;
+        }
+
+        // Unsaved edits are kept in memory until the interval runs out, unless somebody is waiting for them
+        long long deadline_ms = persister->dirty_since_ms + persister->autosave_interval_ms;
+        int urgent_flag = persister->started_saves < persister->requested_saves;
+        if (!urgent_flag && monotonic_ms() < deadline_ms) {
+            struct timespec deadline = ms_to_timespec(deadline_ms);
+            pthread_cond_timedwait(&persister->work_cond, &persister->lock, &deadline);
+            continue;
+        }
+
+        Contact *snapshot = persister->pending;
+        int snapshot_count = persister->pending_count;
+        int snapshot_capacity = persister->pending_capacity;
+        persister->pending = persister->writing;
+        persister->pending_capacity = persister->writing_capacity;
+        persister->pending_count = 0;
+        persister->pending_dirty = 0;
+        persister->writing = snapshot;
+        persister->writing_capacity = snapshot_capacity;
+        persister->started_saves++;
+        pthread_mutex_unlock(&persister->lock);
+
+        int error = write_snapshot(persister, snapshot, snapshot_count);
+
+        pthread_mutex_lock(&persister->lock);
+        persister->finished_saves++;
+        persister->last_error = error;
+        if (error && !persister->pending_dirty) {
+            // Nothing newer was submitted during the save, so the failed snapshot is retried after another interval
+            persister->writing = persister->pending;
+            persister->writing_capacity = persister->pending_capacity;
+            persister->pending = snapshot;
+            persister->pending_capacity = snapshot_capacity;
+            persister->pending_count = snapshot_count;
+            persister->pending_dirty = 1;
+            persister->dirty_since_ms = monotonic_ms();
+        }
+        pthread_cond_broadcast(&persister->done_cond);
+    }
+    pthread_mutex_unlock(&persister->lock);
+
+    return NULL;
+}
+
+static void free_persister(Persister *persister) {
+    free(persister->output_file);
+    free(persister->temp_file);
+    free(persister->directory);
+    free(persister->pending);
+    free(persister->writing);
+    free(persister);
+}
+
+Persister *persister_start(const char *output_file, int autosave_interval_ms) {
+    if (output_file == NULL || autosave_interval_ms < 0) {
+        return NULL;
+    }
+
+    Persister *persister = calloc(1, sizeof(Persister));
+    if (persister == NULL) {
+        return NULL;
+    }
+    persister->autosave_interval_ms = autosave_interval_ms;
+    persister->output_file = malloc(strlen(output_file) + 1);
+    persister->temp_file = malloc(strlen(output_file) + sizeof(".tmp"));
+    // The directory is the part of the path before the last slash, or the working directory without one
+    const char *last_slash = strrchr(output_file, '/');
+    size_t directory_length = last_slash == NULL ? 1 : last_slash == output_file ? 1 : (size_t) (last_slash - output_file);
+    persister->directory = malloc(directory_length + 1);
+    if (persister->output_file == NULL || persister->temp_file == NULL || persister->directory == NULL) {
+        free_persister(persister);
+        return NULL;
+    }
+    strcpy(persister->output_file, output_file);
+    strcpy(persister->temp_file, output_file);
+    strcat(persister->temp_file, ".tmp");
+    if (last_slash == NULL) {
+        strcpy(persister->directory, ".");
+    } else {
+        memcpy(persister->directory, output_file, directory_length);
+        persister->directory[directory_length] = '\0';
+    }
+
+    // Deadlines are computed from the monotonic clock, so the timed wait has to use it as well
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&persister->lock, NULL);
+    pthread_cond_init(&persister->work_cond, &cond_attr);
+    pthread_cond_init(&persister->done_cond, NULL);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&persister->thread, NULL, persister_thread, persister) != 0) {
+        fprintf(stderr, "Failed to start the persistence thread for the file: %s\n", output_file);
+        pthread_cond_destroy(&persister->work_cond);
+        pthread_cond_destroy(&persister->done_cond);
+        pthread_mutex_destroy(&persister->lock);
+        free_persister(persister);
+        return NULL;
+    }
+
+    return persister;
+}
+
+// Makes room for the contacts of the next snapshot. Called with the lock held, returns 0 on success
+static int reserve_pending(Persister *persister, int contact_count) {
+    if (contact_count <= persister->pending_capacity) {
+        return 0;
+    }
+    // Grow geometrically, so that a book growing by one contact at a time does not reallocate on every edit
+    int new_capacity = persister->pending_capacity * 2;
+    if (new_capacity < contact_count) {
+        new_capacity = contact_count;
+    }
+    Contact *new_pending = realloc(persister->pending, sizeof(Contact) * new_capacity);
+    if (new_pending == NULL) {
+        return 1;
+    }
+    persister->pending = new_pending;
+    persister->pending_capacity = new_capacity;
+    return 0;
+}
+
+// Marks the pending snapshot as a new submission and wakes the I/O thread. Called with the lock held
+static void commit_pending(Persister *persister, int contact_count) {
+    persister->pending_count = contact_count;
+    if (!persister->pending_dirty) {
+        persister->dirty_since_ms = monotonic_ms();
+        persister->pending_dirty = 1;
+    }
+    pthread_cond_signal(&persister->work_cond);
+}
+
+int persister_submit(Persister *persister, const Contact *database, int contact_count) {
+    if (persister == NULL ||
+        contact_count < 0 ||
+        (database == NULL && contact_count > 0)) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&persister->lock);
+    if (reserve_pending(persister, contact_count)) {
+        pthread_mutex_unlock(&persister->lock);
+        return 1;
+    }
+    if (contact_count > 0) {
+        memcpy(persister->pending, database, sizeof(Contact) * contact_count);
+    }
+    commit_pending(persister, contact_count);
+    pthread_mutex_unlock(&persister->lock);
+
+    return 0;
+}
+
+int persister_submit_db(Persister *persister, const ContactDB *db) {
+    if (persister == NULL || db == NULL) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&persister->lock);
+    if (reserve_pending(persister, db->count)) {
+        pthread_mutex_unlock(&persister->lock);
+        return 1;
+    }
+    for (int i = 0; i < db->count; ++i) {
+        persister->pending[i] = *db->contacts[i];
+    }
+    commit_pending(persister, db->count);
+    pthread_mutex_unlock(&persister->lock);
+
+    return 0;
+}
+
+// Asks the I/O thread to save the pending snapshot right away, or to finish the save in progress.
+// Called with the lock held, returns the number of the save to wait for
+static unsigned long long request_save(Persister *persister) {
+    unsigned long long target_save = persister->started_saves + (persister->pending_dirty ? 1 : 0);
+    if (persister->requested_saves < target_save) {
+        persister->requested_saves = target_save;
+        pthread_cond_signal(&persister->work_cond);
+    }
+    return target_save;
+}
+
+int persister_flush(Persister *persister) {
+    if (persister == NULL) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&persister->lock);
+    unsigned long long target_save = request_save(persister);
+    while (persister->finished_saves < target_save) {
+        pthread_cond_wait(&persister->done_cond, &persister->lock);
+    }
+    int error = persister->last_error;
+    pthread_mutex_unlock(&persister->lock);
+
+    return error;
+}
+
+int persister_stop(Persister *persister) {
+    if (persister == NULL) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&persister->lock);
+    request_save(persister);
+    persister->stop_flag = 1;
+    pthread_cond_signal(&persister->work_cond);
+    pthread_mutex_unlock(&persister->lock);
+
+    // The thread exits only once everything submitted is written
+    pthread_join(persister->thread, NULL);
+    int error = persister->last_error;
+
+    pthread_cond_destroy(&persister->work_cond);
+    pthread_cond_destroy(&persister->done_cond);
+    pthread_mutex_destroy(&persister->lock);
+    free_persister(persister);
+
+    return error;
+}
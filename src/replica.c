@@ -0,0 +1,166 @@
+#include <stddef.h>
+#include "replica.h"
+
+ChangeFeedStatus replica_applier_init(ReplicaApplier *applier, ContactDB *replica, uint64_t applied_seq) {
+    if (applier == NULL || replica == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    applier->replica = replica;
+    applier->applied_seq = applied_seq;
+    applier->feed_id = 0;
+    applier->snapshot_flag = 0;
+    applier->source = NULL;
+    return CHANGE_FEED_OK;
+}
+
+void replica_applier_set_source(ReplicaApplier *applier, const ContactDB *source) {
+    if (applier == NULL) {
+        return;
+    }
+    applier->source = source;
+}
+
+ChangeFeedStatus replica_resync(ReplicaApplier *applier, const ContactDB *source) {
+    if (applier == NULL || source == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    uint64_t head_seq;
+    if (contact_db_snapshot(source, applier->replica, &head_seq) != CONTACT_OK) {
+        return CHANGE_FEED_ERROR;
+    }
+    applier->applied_seq = head_seq;
+    applier->feed_id = change_feed_id(source->feed);
+    applier->snapshot_flag = 0;
+    return CHANGE_FEED_OK;
+}
+
+// Checks that the events come from the feed applied_seq belongs to, adopting the feed of a replica that has none yet
+static ChangeFeedStatus check_feed(ReplicaApplier *applier, uint64_t feed_id) {
+    if (feed_id == 0 || feed_id == applier->feed_id) {
+        return CHANGE_FEED_OK; // a stream without a header has no id to compare
+    }
+    if (applier->feed_id == 0 || applier->applied_seq == 0) {
+        applier->feed_id = feed_id;
+        return CHANGE_FEED_OK;
+    }
+    // The sequence numbers of another feed say nothing about which of its events the replica reflects
+    return CHANGE_FEED_OVERRUN;
+}
+
+// Applies a record of a snapshot sent by a feed server, which replaces the replica
+static ChangeFeedStatus apply_snapshot(ReplicaApplier *applier, const ChangeEvent *event) {
+    if (event->type == CHANGE_SNAPSHOT_BEGIN) {
+        // Until the end of the snapshot, the replica reflects no event, and it adopts the feed of the stream
+        contact_db_free(applier->replica);
+        applier->applied_seq = 0;
+        applier->feed_id = 0;
+        applier->snapshot_flag = 1;
+        return CHANGE_FEED_OK;
+    }
+    if (!applier->snapshot_flag) {
+        return CHANGE_FEED_ERROR;
+    }
+    if (event->type == CHANGE_SNAPSHOT_CONTACT) {
+        ContactStatus status = contact_db_add(applier->replica, event->contact.name, event->contact.phone,
+                                              event->contact.email);
+        return status == CONTACT_OK ? CHANGE_FEED_OK : CHANGE_FEED_ERROR;
+    }
+    applier->applied_seq = event->seq;
+    applier->snapshot_flag = 0;
+    return CHANGE_FEED_OK;
+}
+
+ChangeFeedStatus replica_apply(ReplicaApplier *applier, const ChangeEvent *event) {
+    if (applier == NULL || event == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    if (event->type == CHANGE_SNAPSHOT_BEGIN || event->type == CHANGE_SNAPSHOT_CONTACT ||
+        event->type == CHANGE_SNAPSHOT_END) {
+        return apply_snapshot(applier, event);
+    }
+    if (applier->snapshot_flag) {
+        return CHANGE_FEED_ERROR; // an event in the middle of a snapshot
+    }
+    if (event->seq <= applier->applied_seq) {
+        return CHANGE_FEED_OK; // already applied
+    }
+    if (event->seq != applier->applied_seq + 1) {
+        return CHANGE_FEED_OVERRUN;
+    }
+
+    ContactStatus status;
+    switch (event->type) {
+        case CHANGE_ADD:
+            status = contact_db_add(applier->replica, event->contact.name, event->contact.phone, event->contact.email);
+            break;
+        case CHANGE_DELETE:
+            status = contact_db_delete(applier->replica, event->contact.name);
+            break;
+        default:
+            status = CONTACT_ERR_INVALID;
+            break;
+    }
+    if (status != CONTACT_OK) {
+        return CHANGE_FEED_ERROR;
+    }
+
+    applier->applied_seq = event->seq;
+    return CHANGE_FEED_OK;
+}
+
+ChangeFeedStatus replica_catch_up(ReplicaApplier *applier, ChangeSubscriber *subscriber) {
+    if (applier == NULL || subscriber == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    ChangeEvent event;
+    ChangeFeedStatus status;
+    do {
+        status = check_feed(applier, change_feed_id(subscriber->feed));
+        if (status == CHANGE_FEED_OK) {
+            status = change_subscriber_poll(subscriber, &event);
+        }
+        if (status == CHANGE_FEED_OK) {
+            status = replica_apply(applier, &event);
+        }
+        // The lost events are replaced by a copy of the source, and the feed is read on after the copy
+        if (status == CHANGE_FEED_OVERRUN && applier->source != NULL) {
+            status = replica_resync(applier, applier->source);
+            if (status == CHANGE_FEED_OK) {
+                status = change_subscriber_init(subscriber, subscriber->feed, applier->applied_seq);
+            }
+        }
+    } while (status == CHANGE_FEED_OK);
+    return status;
+}
+
+ChangeFeedStatus replica_catch_up_stream(ReplicaApplier *applier, ChangeStreamReader *reader) {
+    if (applier == NULL || reader == NULL) {
+        return CHANGE_FEED_ERROR;
+    }
+    ChangeEvent event;
+    ChangeFeedStatus status;
+    do {
+        status = change_stream_read(reader, &event);
+        // A snapshot replaces the replica whichever feed it reflected before
+        if (status == CHANGE_FEED_OK && event.type != CHANGE_SNAPSHOT_BEGIN) {
+            status = check_feed(applier, reader->feed_id);
+        }
+        if (status == CHANGE_FEED_OK) {
+            status = replica_apply(applier, &event);
+        }
+        // The events after the copy follow in the stream, the ones before it are ignored by replica_apply.
+        // A stream of another feed than the source cannot be continued after the copy though
+        if (status == CHANGE_FEED_OVERRUN && applier->source != NULL) {
+            status = replica_resync(applier, applier->source);
+            if (status == CHANGE_FEED_OK && reader->feed_id != 0 && reader->feed_id != applier->feed_id) {
+                status = CHANGE_FEED_OVERRUN;
+            }
+        }
+    } while (status == CHANGE_FEED_OK);
+    // A snapshot cut off by the end of the stream is discarded, so the replica is consistent (and empty) again
+    if (applier->snapshot_flag && status != CHANGE_FEED_EMPTY) {
+        contact_db_free(applier->replica);
+        applier->snapshot_flag = 0;
+    }
+    return status;
+}
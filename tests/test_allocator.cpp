@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "allocator.h"
+}
+
+#define NUM_OF_TEST_ALLOCATIONS 1000
+#define TEST_BLOCK_SIZE 200
+
+static bool is_aligned(const void *ptr) {
+    return reinterpret_cast<uintptr_t>(ptr) % 16 == 0;
+}
+
+// ===============================
+// = UNIT TESTS: arena allocator =
+// ===============================
+
+// Allocations must not overlap, and must keep their contents while the arena grows
+TEST_CASE("Arena allocation test", "[allocator]") {
+    ArenaAllocator *arena = arena_create(4096);
+    REQUIRE(arena != nullptr);
+    ContactAllocator allocator = arena_as_allocator(arena);
+
+    unsigned char *blocks[NUM_OF_TEST_ALLOCATIONS];
+    for (int i = 0; i < NUM_OF_TEST_ALLOCATIONS; ++i) {
+        blocks[i] = static_cast<unsigned char *>(allocator.allocate(allocator.context, TEST_BLOCK_SIZE));
+        REQUIRE(blocks[i] != nullptr);
+        REQUIRE(is_aligned(blocks[i]));
+        memset(blocks[i], i % 256, TEST_BLOCK_SIZE);
+    }
+    // An oversized allocation gets a block of its own
+    void *large_block = allocator.allocate(allocator.context, 10000);
+    REQUIRE(large_block != nullptr);
+    memset(large_block, 0xAB, 10000);
+
+    for (int i = 0; i < NUM_OF_TEST_ALLOCATIONS; ++i) {
+        for (int j = 0; j < TEST_BLOCK_SIZE; ++j) {
+            REQUIRE(blocks[i][j] == i % 256);
+        }
+    }
+
+    arena_reset(arena);
+    void *reused_block = allocator.allocate(allocator.context, TEST_BLOCK_SIZE);
+    REQUIRE(reused_block != nullptr);
+
+    arena_destroy(arena);
+}
+
+// The most recent allocation is resized in place, the others are copied
+TEST_CASE("Arena reallocation test", "[allocator]") {
+    ArenaAllocator *arena = arena_create(4096);
+    REQUIRE(arena != nullptr);
+    ContactAllocator allocator = arena_as_allocator(arena);
+
+    char *first = static_cast<char *>(allocator.allocate(allocator.context, 64));
+    strcpy(first, "first block");
+    char *grown = static_cast<char *>(allocator.reallocate(allocator.context, first, 64, 128));
+    REQUIRE(grown == first);
+
+    char *second = static_cast<char *>(allocator.allocate(allocator.context, 64));
+    REQUIRE(second != first);
+    char *moved = static_cast<char *>(allocator.reallocate(allocator.context, first, 128, 256));
+    REQUIRE(moved != first);
+    REQUIRE(strcmp(moved, "first block") == 0);
+
+    // Growing beyond the block size still keeps the contents
+    char *huge = static_cast<char *>(allocator.reallocate(allocator.context, moved, 256, 100000));
+    REQUIRE(huge != nullptr);
+    REQUIRE(strcmp(huge, "first block") == 0);
+
+    // Freeing the most recent allocation makes its space available again
+    char *last = static_cast<char *>(allocator.allocate(allocator.context, 64));
+    allocator.deallocate(allocator.context, last, 64);
+    REQUIRE(allocator.allocate(allocator.context, 64) == last);
+
+    arena_destroy(arena);
+}
+
+// Sizes that would wrap around when aligned are reported as a failure, and the arena stays usable
+TEST_CASE("Arena size overflow test", "[allocator]") {
+    REQUIRE(arena_create(SIZE_MAX) == nullptr);
+    ArenaAllocator *arena = arena_create(4096);
+    REQUIRE(arena != nullptr);
+    ContactAllocator allocator = arena_as_allocator(arena);
+
+    REQUIRE(allocator.allocate(allocator.context, SIZE_MAX) == nullptr);
+    REQUIRE(allocator.allocate(allocator.context, SIZE_MAX - 5) == nullptr);
+    char *block = static_cast<char *>(allocator.allocate(allocator.context, 64));
+    REQUIRE(block != nullptr);
+    strcpy(block, "still valid");
+    REQUIRE(allocator.reallocate(allocator.context, block, 64, SIZE_MAX - 5) == nullptr);
+    REQUIRE(allocator.reallocate(allocator.context, nullptr, 0, SIZE_MAX) == nullptr);
+    REQUIRE(strcmp(block, "still valid") == 0);
+
+    arena_destroy(arena);
+}
+
+// ==============================
+// = UNIT TESTS: pool allocator =
+// ==============================
+
+// Freed slots are reused, and every slot is distinct while allocated
+TEST_CASE("Pool allocation test", "[allocator]") {
+    PoolAllocator *pool = pool_create(TEST_BLOCK_SIZE, 64);
+    REQUIRE(pool != nullptr);
+    ContactAllocator allocator = pool_as_allocator(pool);
+
+    void *blocks[NUM_OF_TEST_ALLOCATIONS];
+    std::set<void *> distinct_blocks;
+    for (int i = 0; i < NUM_OF_TEST_ALLOCATIONS; ++i) {
+        blocks[i] = allocator.allocate(allocator.context, TEST_BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+        REQUIRE(is_aligned(blocks[i]));
+        memset(blocks[i], 0xCD, TEST_BLOCK_SIZE);
+        distinct_blocks.insert(blocks[i]);
+    }
+    REQUIRE(distinct_blocks.size() == NUM_OF_TEST_ALLOCATIONS);
+
+    for (int i = 0; i < NUM_OF_TEST_ALLOCATIONS; i += 2) {
+        allocator.deallocate(allocator.context, blocks[i], TEST_BLOCK_SIZE);
+    }
+    for (int i = 0; i < NUM_OF_TEST_ALLOCATIONS; i += 2) {
+        void *reused_block = allocator.allocate(allocator.context, TEST_BLOCK_SIZE);
+        REQUIRE(distinct_blocks.count(reused_block) == 1);
+    }
+
+    pool_destroy(pool);
+}
+
+// Blocks larger than a slot are passed through to malloc, also when a block grows out of its slot
+TEST_CASE("Pool reallocation test", "[allocator]") {
+    PoolAllocator *pool = pool_create(TEST_BLOCK_SIZE, 64);
+    REQUIRE(pool != nullptr);
+    ContactAllocator allocator = pool_as_allocator(pool);
+
+    char *block = static_cast<char *>(allocator.reallocate(allocator.context, nullptr, 0, 32));
+    REQUIRE(block != nullptr);
+    strcpy(block, "pooled");
+    REQUIRE(allocator.reallocate(allocator.context, block, 32, TEST_BLOCK_SIZE) == block);
+
+    char *large_block = static_cast<char *>(allocator.reallocate(allocator.context, block, TEST_BLOCK_SIZE, 4096));
+    REQUIRE(large_block != nullptr);
+    REQUIRE(strcmp(large_block, "pooled") == 0);
+    large_block = static_cast<char *>(allocator.reallocate(allocator.context, large_block, 4096, 8192));
+    REQUIRE(strcmp(large_block, "pooled") == 0);
+    allocator.deallocate(allocator.context, large_block, 8192);
+
+    pool_destroy(pool);
+}
+
+// Set different values of the input to null or out of range
+TEST_CASE("Allocator null test", "[allocator]") {
+    REQUIRE(pool_create(0, 64) == nullptr);
+    REQUIRE(pool_create(TEST_BLOCK_SIZE, 0) == nullptr);
+    arena_reset(nullptr);
+    arena_destroy(nullptr);
+    pool_destroy(nullptr);
+
+    const ContactAllocator *allocator = system_allocator();
+    REQUIRE(allocator != nullptr);
+    void *block = allocator->allocate(allocator->context, TEST_BLOCK_SIZE);
+    REQUIRE(block != nullptr);
+    block = allocator->reallocate(allocator->context, block, TEST_BLOCK_SIZE, 2 * TEST_BLOCK_SIZE);
+    REQUIRE(block != nullptr);
+    allocator->deallocate(allocator->context, block, 2 * TEST_BLOCK_SIZE);
+}
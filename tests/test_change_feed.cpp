@@ -0,0 +1,256 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "contact_db.h"
+}
+
+#define NUM_OF_TEST_EVENTS 1000
+
+static Contact make_contact(int i) {
+    Contact contact;
+    std::string i_str = std::to_string(i);
+    strcpy(contact.name, ("Name" + i_str).c_str());
+    strcpy(contact.phone, ("+370123" + i_str).c_str());
+    strcpy(contact.email, ("testemail" + i_str + "@gmail.com").c_str());
+    return contact;
+}
+
+// ===========================
+// = UNIT TESTS: change feed =
+// ===========================
+
+TEST_CASE("Change feed order test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(NUM_OF_TEST_EVENTS);
+    REQUIRE(feed != nullptr);
+    ChangeSubscriber subscriber;
+    REQUIRE(change_subscriber_init(&subscriber, feed, 0) == CHANGE_FEED_OK);
+    ChangeEvent event;
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_EMPTY);
+
+    for (int i = 0; i < NUM_OF_TEST_EVENTS; ++i) {
+        Contact contact = make_contact(i);
+        REQUIRE(change_feed_publish(feed, i % 2 ? CHANGE_DELETE : CHANGE_ADD, &contact) == (uint64_t) i + 1);
+    }
+    REQUIRE(change_feed_head(feed) == NUM_OF_TEST_EVENTS);
+
+    for (int i = 0; i < NUM_OF_TEST_EVENTS; ++i) {
+        REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+        REQUIRE(event.seq == (uint64_t) i + 1);
+        REQUIRE(event.type == (i % 2 ? CHANGE_DELETE : CHANGE_ADD));
+        REQUIRE(strcmp(event.contact.name, ("Name" + std::to_string(i)).c_str()) == 0);
+    }
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_EMPTY);
+
+    change_feed_destroy(feed);
+}
+
+// Subscribers read independently, and can resume after any event still in the ring
+TEST_CASE("Change feed resume test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(64);
+    REQUIRE(feed != nullptr);
+    for (int i = 0; i < 10; ++i) {
+        Contact contact = make_contact(i);
+        change_feed_publish(feed, CHANGE_ADD, &contact);
+    }
+
+    ChangeSubscriber from_start, resumed, new_only;
+    change_subscriber_init(&from_start, feed, 0);
+    change_subscriber_init(&resumed, feed, 7);
+    change_subscriber_init(&new_only, feed, change_feed_head(feed));
+    ChangeEvent event;
+    REQUIRE(change_subscriber_poll(&resumed, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.seq == 8);
+    REQUIRE(change_subscriber_poll(&from_start, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.seq == 1);
+    REQUIRE(change_subscriber_poll(&new_only, &event) == CHANGE_FEED_EMPTY);
+
+    Contact contact = make_contact(10);
+    change_feed_publish(feed, CHANGE_ADD, &contact);
+    REQUIRE(change_subscriber_poll(&new_only, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.seq == 11);
+
+    change_feed_destroy(feed);
+}
+
+// A subscriber that falls more than the capacity behind is told so instead of skipping events silently
+TEST_CASE("Change feed overrun test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(10); // rounded up to 16
+    REQUIRE(feed != nullptr);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+
+    for (int i = 0; i < 16; ++i) {
+        Contact contact = make_contact(i);
+        change_feed_publish(feed, CHANGE_ADD, &contact);
+    }
+    ChangeEvent event;
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.seq == 1);
+
+    for (int i = 16; i < 20; ++i) {
+        Contact contact = make_contact(i);
+        change_feed_publish(feed, CHANGE_ADD, &contact);
+    }
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OVERRUN);
+    REQUIRE(subscriber.next_seq == 2);
+
+    // Resynchronizing from the oldest event still in the ring works
+    change_subscriber_init(&subscriber, feed, change_feed_head(feed) - 16);
+    for (uint64_t seq = 5; seq <= 20; ++seq) {
+        REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+        REQUIRE(event.seq == seq);
+    }
+
+    change_feed_destroy(feed);
+}
+
+TEST_CASE("Change feed concurrent subscriber test", "[change_feed]") {
+    const int event_count = 200000;
+    ChangeFeed *feed = change_feed_create(1 << 16);
+    REQUIRE(feed != nullptr);
+
+    std::atomic<uint64_t> consumed(0);
+
+    std::thread producer([feed, event_count, &consumed]() {
+        Contact contact = make_contact(0);
+        for (int i = 0; i < event_count; ++i) {
+            // Stay within half of the ring, so that every event has to arrive intact and in order
+            while ((uint64_t) i >= consumed.load() + (1 << 15)) {
+                std::this_thread::yield();
+            }
+            change_feed_publish(feed, CHANGE_ADD, &contact);
+        }
+    });
+
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    uint64_t expected_seq = 1;
+    int error_flag = 0;
+    while (expected_seq <= (uint64_t) event_count && !error_flag) {
+        ChangeEvent event;
+        ChangeFeedStatus status = change_subscriber_poll(&subscriber, &event);
+        if (status == CHANGE_FEED_EMPTY) {
+            std::this_thread::yield();
+        } else if (status != CHANGE_FEED_OK || event.seq != expected_seq || strcmp(event.contact.name, "Name0") != 0) {
+            error_flag = 1;
+        } else {
+            consumed.store(expected_seq++);
+        }
+    }
+    producer.join();
+    REQUIRE(error_flag == 0);
+
+    change_feed_destroy(feed);
+}
+
+// A waiting subscriber sleeps until an event is published, instead of polling
+TEST_CASE("Change feed wait test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    REQUIRE(change_subscriber_wait(&subscriber, 10) == CHANGE_FEED_EMPTY);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([feed]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Contact contact = make_contact(0);
+        change_feed_publish(feed, CHANGE_ADD, &contact);
+    });
+    REQUIRE(change_subscriber_wait(&subscriber, 10000) == CHANGE_FEED_OK);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    producer.join();
+    ChangeEvent event;
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.seq == 1);
+
+    // An event that is already available returns right away
+    Contact contact = make_contact(1);
+    change_feed_publish(feed, CHANGE_ADD, &contact);
+    REQUIRE(change_subscriber_wait(&subscriber, 0) == CHANGE_FEED_OK);
+
+    change_feed_destroy(feed);
+}
+
+// ============================================
+// = UNIT TESTS: contact database change feed =
+// ============================================
+
+// Only successful changes are published
+TEST_CASE("Contact database change feed test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(64);
+    REQUIRE(feed != nullptr);
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+    REQUIRE(contact_db_add(&db, "Before", "1", "before@gmail.com") == CONTACT_OK);
+    contact_db_attach_feed(&db, feed);
+
+    REQUIRE(contact_db_add(&db, "First", "1", "first@gmail.com") == CONTACT_OK);
+    REQUIRE(contact_db_add(&db, "First", "2", "first@gmail.com") == CONTACT_ERR_DUPLICATE);
+    REQUIRE(contact_db_add(&db, "Invalid", "", "invalid@gmail.com") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_delete(&db, "Missing") == CONTACT_ERR_NOT_FOUND);
+    REQUIRE(contact_db_delete(&db, "Before") == CONTACT_OK);
+    REQUIRE(change_feed_head(feed) == 2);
+
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    ChangeEvent event;
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.type == CHANGE_ADD);
+    REQUIRE(strcmp(event.contact.phone, "1") == 0);
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.type == CHANGE_DELETE);
+    REQUIRE(strcmp(event.contact.email, "before@gmail.com") == 0);
+
+    contact_db_attach_feed(&db, nullptr);
+    REQUIRE(contact_db_add(&db, "After", "1", "after@gmail.com") == CONTACT_OK);
+    REQUIRE(change_feed_head(feed) == 2);
+
+    contact_db_free(&db);
+    change_feed_destroy(feed);
+}
+
+// Every feed numbers its events from 1, so the id is what tells two feeds apart
+TEST_CASE("Change feed id test", "[change_feed]") {
+    ChangeFeed *feed = change_feed_create(1);
+    ChangeFeed *other_feed = change_feed_create(1);
+    REQUIRE(feed != nullptr);
+    REQUIRE(other_feed != nullptr);
+    REQUIRE(change_feed_id(feed) != 0);
+    REQUIRE(change_feed_id(feed) != change_feed_id(other_feed));
+    REQUIRE(change_feed_id(nullptr) == 0);
+
+    change_feed_destroy(feed);
+    change_feed_destroy(other_feed);
+}
+
+TEST_CASE("Change feed null test", "[change_feed]") {
+    REQUIRE(change_feed_create(0) == nullptr);
+    ChangeFeed *feed = change_feed_create(1);
+    REQUIRE(feed != nullptr);
+    Contact contact = make_contact(0);
+    ChangeSubscriber subscriber;
+    ChangeEvent event;
+
+    REQUIRE(change_feed_publish(nullptr, CHANGE_ADD, &contact) == 0);
+    REQUIRE(change_feed_publish(feed, CHANGE_ADD, nullptr) == 0);
+    // Snapshots are only sent by feed servers, they are not changes of the database
+    REQUIRE(change_feed_publish(feed, CHANGE_SNAPSHOT_BEGIN, &contact) == 0);
+    REQUIRE(change_feed_head(feed) == 0);
+    REQUIRE(change_feed_head(nullptr) == 0);
+    REQUIRE(change_subscriber_init(nullptr, feed, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(change_subscriber_init(&subscriber, nullptr, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(change_subscriber_init(&subscriber, feed, 0) == CHANGE_FEED_OK);
+    REQUIRE(change_subscriber_poll(nullptr, &event) == CHANGE_FEED_ERROR);
+    REQUIRE(change_subscriber_poll(&subscriber, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(change_subscriber_wait(nullptr, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(change_subscriber_wait(&subscriber, -1) == CHANGE_FEED_ERROR);
+
+    change_feed_destroy(nullptr);
+    change_feed_destroy(feed);
+}
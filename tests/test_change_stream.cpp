@@ -0,0 +1,418 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "change_stream.h"
+}
+
+#define NUM_OF_TEST_EVENTS 100
+
+static const char *journal_file = "test_change_journal.bin";
+static const char *socket_file = "test_change_feed.sock";
+
+// The contact of the i-th change: every third change deletes the contact added by the change before it
+static Contact make_contact(int i) {
+    Contact contact;
+    int index = i % 3 == 2 ? i - 1 : i;
+    std::string index_str = std::to_string(index);
+    strcpy(contact.name, ("Name" + index_str).c_str());
+    strcpy(contact.phone, ("+370123" + index_str).c_str());
+    strcpy(contact.email, ("testemail" + index_str + "@gmail.com").c_str());
+    return contact;
+}
+
+static void publish_contacts(ChangeFeed *feed, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        Contact contact = make_contact(i);
+        change_feed_publish(feed, i % 3 == 2 ? CHANGE_DELETE : CHANGE_ADD, &contact);
+    }
+}
+
+// Makes the same changes as publish_contacts, through a database with the feed attached
+static void change_database(ContactDB *db, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        Contact contact = make_contact(i);
+        REQUIRE((i % 3 == 2 ? contact_db_delete(db, contact.name)
+                            : contact_db_add(db, contact.name, contact.phone, contact.email)) == CONTACT_OK);
+    }
+}
+
+static void require_events(ChangeStreamReader *reader, uint64_t first_seq, uint64_t last_seq) {
+    for (uint64_t seq = first_seq; seq <= last_seq; ++seq) {
+        ChangeEvent event;
+        REQUIRE(change_stream_read(reader, &event) == CHANGE_FEED_OK);
+        REQUIRE(event.seq == seq);
+        int i = (int) seq - 1;
+        Contact contact = make_contact(i);
+        REQUIRE(event.type == (i % 3 == 2 ? CHANGE_DELETE : CHANGE_ADD));
+        REQUIRE(strcmp(event.contact.name, contact.name) == 0);
+        REQUIRE(strcmp(event.contact.email, contact.email) == 0);
+    }
+}
+
+// Reads a snapshot, which has to hold the contacts of the database as of the event seq
+static void require_snapshot(ChangeStreamReader *reader, const ContactDB *db, uint64_t seq) {
+    ChangeEvent event;
+    REQUIRE(change_stream_read(reader, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.type == CHANGE_SNAPSHOT_BEGIN);
+    REQUIRE(event.seq == seq);
+    for (int i = 0; i < db->count; ++i) {
+        REQUIRE(change_stream_read(reader, &event) == CHANGE_FEED_OK);
+        REQUIRE(event.type == CHANGE_SNAPSHOT_CONTACT);
+        REQUIRE(event.seq == seq);
+        REQUIRE(strcmp(event.contact.name, db->contacts[i]->name) == 0);
+        REQUIRE(strcmp(event.contact.phone, db->contacts[i]->phone) == 0);
+        REQUIRE(strcmp(event.contact.email, db->contacts[i]->email) == 0);
+    }
+    REQUIRE(change_stream_read(reader, &event) == CHANGE_FEED_OK);
+    REQUIRE(event.type == CHANGE_SNAPSHOT_END);
+    REQUIRE(event.seq == seq);
+}
+
+// ============================
+// = UNIT TESTS: journal file =
+// ============================
+
+TEST_CASE("Change journal tail test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(NUM_OF_TEST_EVENTS);
+    REQUIRE(feed != nullptr);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(write_fd >= 0);
+    REQUIRE(read_fd >= 0);
+
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    ChangeStreamReader reader;
+    REQUIRE(change_stream_reader_init(&reader, read_fd) == CHANGE_FEED_OK);
+    ChangeEvent event;
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+    REQUIRE(reader.feed_id == 0);
+
+    // The journal starts with the header, which is not counted as an event
+    publish_contacts(feed, 0, NUM_OF_TEST_EVENTS / 2);
+    int written_count;
+    REQUIRE(change_stream_pump(&subscriber, write_fd, &written_count) == CHANGE_FEED_OK);
+    REQUIRE(written_count == NUM_OF_TEST_EVENTS / 2);
+    require_events(&reader, 1, NUM_OF_TEST_EVENTS / 2);
+    REQUIRE(reader.feed_id == change_feed_id(feed));
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+
+    // The reader keeps following the journal as it grows, even when a record is only partially written
+    publish_contacts(feed, NUM_OF_TEST_EVENTS / 2, NUM_OF_TEST_EVENTS);
+    int pipe_fds[2];
+    REQUIRE(pipe(pipe_fds) == 0);
+    REQUIRE(change_stream_pump(&subscriber, pipe_fds[1], &written_count) == CHANGE_FEED_OK);
+    REQUIRE(written_count == NUM_OF_TEST_EVENTS / 2);
+    unsigned char records[NUM_OF_TEST_EVENTS / 2 * CHANGE_RECORD_SIZE];
+    REQUIRE(read(pipe_fds[0], records, sizeof(records)) == (ssize_t) sizeof(records));
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    size_t split = sizeof(records) - CHANGE_RECORD_SIZE / 2;
+    REQUIRE(write(write_fd, records, split) == (ssize_t) split);
+    require_events(&reader, NUM_OF_TEST_EVENTS / 2 + 1, NUM_OF_TEST_EVENTS - 1);
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+    REQUIRE(write(write_fd, records + split, sizeof(records) - split) == (ssize_t) (sizeof(records) - split));
+    require_events(&reader, NUM_OF_TEST_EVENTS, NUM_OF_TEST_EVENTS);
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    change_feed_destroy(feed);
+}
+
+TEST_CASE("Change journal seek test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(NUM_OF_TEST_EVENTS);
+    REQUIRE(feed != nullptr);
+    publish_contacts(feed, 0, NUM_OF_TEST_EVENTS);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    REQUIRE(write_fd >= 0);
+
+    // The journal starts at the 11th event
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 10);
+    REQUIRE(change_stream_pump(&subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(read_fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, read_fd);
+    REQUIRE(change_stream_seek(&reader, 42) == CHANGE_FEED_OK);
+    REQUIRE(reader.feed_id == change_feed_id(feed));
+    require_events(&reader, 43, 45);
+    REQUIRE(change_stream_seek(&reader, 10) == CHANGE_FEED_OK);
+    require_events(&reader, 11, 11);
+    REQUIRE(change_stream_seek(&reader, 5) == CHANGE_FEED_OVERRUN);
+
+    // Seeking past the end waits for the events to be appended
+    REQUIRE(change_stream_seek(&reader, NUM_OF_TEST_EVENTS) == CHANGE_FEED_OK);
+    ChangeEvent event;
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+    publish_contacts(feed, NUM_OF_TEST_EVENTS, NUM_OF_TEST_EVENTS + 1);
+    REQUIRE(change_stream_pump(&subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    require_events(&reader, NUM_OF_TEST_EVENTS + 1, NUM_OF_TEST_EVENTS + 1);
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    change_feed_destroy(feed);
+}
+
+// A subscriber that fell behind writes an overrun record, which the reader reports
+TEST_CASE("Change journal overrun test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    publish_contacts(feed, 0, 20);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(write_fd >= 0);
+    REQUIRE(read_fd >= 0);
+
+    int written_count;
+    REQUIRE(change_stream_pump(&subscriber, write_fd, &written_count) == CHANGE_FEED_OVERRUN);
+    REQUIRE(written_count == 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, read_fd);
+    ChangeEvent event;
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_OVERRUN);
+    REQUIRE(event.seq == 1);
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    change_feed_destroy(feed);
+}
+
+// The events after an overrun record continue at a later sequence number, which seeking has to account for
+TEST_CASE("Change journal seek overrun test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(8);
+    REQUIRE(feed != nullptr);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    REQUIRE(write_fd >= 0);
+
+    // Events 1 to 3, an overrun record at 4 and events 13 to 15
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    publish_contacts(feed, 0, 3);
+    REQUIRE(change_stream_pump(&subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    publish_contacts(feed, 3, 12);
+    REQUIRE(change_stream_pump(&subscriber, write_fd, nullptr) == CHANGE_FEED_OVERRUN);
+    change_subscriber_init(&subscriber, feed, 12);
+    publish_contacts(feed, 12, 15);
+    REQUIRE(change_stream_pump(&subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(read_fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, read_fd);
+    REQUIRE(change_stream_seek(&reader, 13) == CHANGE_FEED_OK);
+    require_events(&reader, 14, 15);
+    REQUIRE(change_stream_seek(&reader, 12) == CHANGE_FEED_OK);
+    require_events(&reader, 13, 13);
+    REQUIRE(change_stream_seek(&reader, 1) == CHANGE_FEED_OK);
+    require_events(&reader, 2, 3);
+    ChangeEvent event;
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_OVERRUN);
+    // The events lost to the overrun cannot be resumed after
+    REQUIRE(change_stream_seek(&reader, 3) == CHANGE_FEED_OVERRUN);
+    REQUIRE(change_stream_seek(&reader, 7) == CHANGE_FEED_OVERRUN);
+    REQUIRE(change_stream_seek(&reader, 15) == CHANGE_FEED_OK);
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_EMPTY);
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    change_feed_destroy(feed);
+}
+
+// =============================
+// = UNIT TESTS: socket server =
+// =============================
+
+TEST_CASE("Change feed server test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(NUM_OF_TEST_EVENTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source;
+    contact_db_init(&source, nullptr);
+    contact_db_attach_feed(&source, feed);
+    change_database(&source, 0, NUM_OF_TEST_EVENTS / 2);
+    ChangeFeedServer *server = change_feed_serve(&source, socket_file);
+    REQUIRE(server != nullptr);
+
+    int fd = change_feed_connect(socket_file, 0, 0);
+    REQUIRE(fd >= 0);
+    ChangeStreamReader reader;
+    REQUIRE(change_stream_reader_init(&reader, fd) == CHANGE_FEED_OK);
+    require_events(&reader, 1, NUM_OF_TEST_EVENTS / 2);
+    REQUIRE(reader.feed_id == change_feed_id(feed));
+    // Events published while connected are streamed as they come
+    change_database(&source, NUM_OF_TEST_EVENTS / 2, NUM_OF_TEST_EVENTS);
+    require_events(&reader, NUM_OF_TEST_EVENTS / 2 + 1, NUM_OF_TEST_EVENTS / 2 + 10);
+    close(fd);
+
+    // A client that reconnects resumes where it left off
+    fd = change_feed_connect(socket_file, change_feed_id(feed), NUM_OF_TEST_EVENTS / 2 + 10);
+    REQUIRE(fd >= 0);
+    change_stream_reader_init(&reader, fd);
+    require_events(&reader, NUM_OF_TEST_EVENTS / 2 + 11, NUM_OF_TEST_EVENTS);
+
+    // A client resuming another feed, e.g. the one before a restart, gets a snapshot instead
+    int other_fd = change_feed_connect(socket_file, change_feed_id(feed) + 1, NUM_OF_TEST_EVENTS / 2);
+    REQUIRE(other_fd >= 0);
+    ChangeStreamReader other_reader;
+    change_stream_reader_init(&other_reader, other_fd);
+    require_snapshot(&other_reader, &source, NUM_OF_TEST_EVENTS);
+    REQUIRE(other_reader.feed_id == change_feed_id(feed));
+    close(other_fd);
+
+    // So does a new client, once the first events were overwritten, and the events after the snapshot follow it
+    change_database(&source, NUM_OF_TEST_EVENTS, 2 * NUM_OF_TEST_EVENTS);
+    require_events(&reader, NUM_OF_TEST_EVENTS + 1, 2 * NUM_OF_TEST_EVENTS);
+    int late_fd = change_feed_connect(socket_file, 0, 0);
+    REQUIRE(late_fd >= 0);
+    ChangeStreamReader late_reader;
+    change_stream_reader_init(&late_reader, late_fd);
+    require_snapshot(&late_reader, &source, 2 * NUM_OF_TEST_EVENTS);
+    change_database(&source, 2 * NUM_OF_TEST_EVENTS, 2 * NUM_OF_TEST_EVENTS + 3);
+    require_events(&late_reader, 2 * NUM_OF_TEST_EVENTS + 1, 2 * NUM_OF_TEST_EVENTS + 3);
+    close(late_fd);
+
+    change_feed_server_stop(server);
+    ChangeEvent event;
+    require_events(&reader, 2 * NUM_OF_TEST_EVENTS + 1, 2 * NUM_OF_TEST_EVENTS + 3);
+    REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_CLOSED);
+    REQUIRE(access(socket_file, F_OK) != 0);
+    close(fd);
+    contact_db_free(&source);
+    change_feed_destroy(feed);
+}
+
+// A client that stops reading falls behind the ring, and gets a snapshot once it reads again
+TEST_CASE("Change feed server overrun test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source;
+    contact_db_init(&source, nullptr);
+    contact_db_attach_feed(&source, feed);
+    ChangeFeedServer *server = change_feed_serve(&source, socket_file);
+    REQUIRE(server != nullptr);
+
+    int fd = change_feed_connect(socket_file, 0, 0);
+    REQUIRE(fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, fd);
+    // Far more than the socket buffers hold, so the server is stuck writing while the ring is overwritten
+    const int change_count = 30 * NUM_OF_TEST_EVENTS;
+    change_database(&source, 0, change_count);
+
+    uint64_t next_seq = 1;
+    int snapshot_count = 0;
+    ChangeEvent event;
+    while (next_seq <= (uint64_t) change_count) {
+        REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_OK);
+        if (event.type == CHANGE_SNAPSHOT_BEGIN) {
+            snapshot_count++;
+            REQUIRE(event.seq >= next_seq);
+            while (event.type != CHANGE_SNAPSHOT_END) {
+                REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_OK);
+            }
+            next_seq = event.seq + 1;
+            continue;
+        }
+        REQUIRE(event.seq == next_seq);
+        next_seq++;
+    }
+    REQUIRE(snapshot_count > 0);
+
+    close(fd);
+    change_feed_server_stop(server);
+    contact_db_free(&source);
+    change_feed_destroy(feed);
+}
+
+TEST_CASE("Change feed server path test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(NUM_OF_TEST_EVENTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source;
+    contact_db_init(&source, nullptr);
+    contact_db_attach_feed(&source, feed);
+
+    // A regular file at the socket path is not deleted
+    FILE *file = fopen(socket_file, "w");
+    REQUIRE(file != nullptr);
+    fputs("keep", file);
+    fclose(file);
+    REQUIRE(change_feed_serve(&source, socket_file) == nullptr);
+    char content[8] = {0};
+    file = fopen(socket_file, "r");
+    REQUIRE(file != nullptr);
+    REQUIRE(fgets(content, sizeof(content), file) != nullptr);
+    fclose(file);
+    REQUIRE(strcmp(content, "keep") == 0);
+    remove(socket_file);
+
+    // A socket left behind by a server that did not stop cleanly is replaced
+    int stale_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_file);
+    REQUIRE(bind(stale_fd, (struct sockaddr *) &address, sizeof(address)) == 0);
+    close(stale_fd);
+    ChangeFeedServer *server = change_feed_serve(&source, socket_file);
+    REQUIRE(server != nullptr);
+
+    // The socket of a running server is not taken over, and it keeps serving
+    REQUIRE(change_feed_serve(&source, socket_file) == nullptr);
+    change_database(&source, 0, 10);
+    int fd = change_feed_connect(socket_file, 0, 0);
+    REQUIRE(fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, fd);
+    require_events(&reader, 1, 10);
+    close(fd);
+    change_feed_server_stop(server);
+
+    contact_db_free(&source);
+    change_feed_destroy(feed);
+}
+
+TEST_CASE("Change stream null test", "[change_stream]") {
+    ChangeFeed *feed = change_feed_create(1);
+    REQUIRE(feed != nullptr);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    ChangeStreamReader reader;
+    ChangeEvent event;
+
+    REQUIRE(change_stream_pump(nullptr, STDOUT_FILENO, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(change_stream_pump(&subscriber, -1, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(change_stream_reader_init(nullptr, STDIN_FILENO) == CHANGE_FEED_ERROR);
+    REQUIRE(change_stream_reader_init(&reader, -1) == CHANGE_FEED_ERROR);
+    REQUIRE(change_stream_seek(nullptr, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(change_stream_read(nullptr, &event) == CHANGE_FEED_ERROR);
+
+    // A database without a feed has no events to serve
+    ContactDB source;
+    contact_db_init(&source, nullptr);
+    REQUIRE(change_feed_serve(&source, socket_file) == nullptr);
+    contact_db_attach_feed(&source, feed);
+    REQUIRE(change_feed_serve(nullptr, socket_file) == nullptr);
+    REQUIRE(change_feed_serve(&source, nullptr) == nullptr);
+    REQUIRE(change_feed_serve(&source, std::string(200, 'a').c_str()) == nullptr);
+    REQUIRE(change_feed_connect(nullptr, 0, 0) == -1);
+    REQUIRE(change_feed_connect(socket_file, 0, 0) == -1);
+    change_feed_server_stop(nullptr);
+
+    contact_db_free(&source);
+    change_feed_destroy(feed);
+}
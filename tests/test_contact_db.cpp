@@ -0,0 +1,290 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "contact_db.h"
+}
+
+#define NUM_OF_TEST_CONTACTS 1000
+
+// Passes allocations through to the system allocator until the budget runs out
+struct BudgetAllocator {
+    int remaining_allocations;
+
+    static void *allocate(void *context, size_t size) {
+        BudgetAllocator *budget = static_cast<BudgetAllocator *>(context);
+        if (budget->remaining_allocations <= 0) {
+            return nullptr;
+        }
+        budget->remaining_allocations--;
+        return malloc(size);
+    }
+
+    static void *reallocate(void *context, void *ptr, size_t, size_t new_size) {
+        BudgetAllocator *budget = static_cast<BudgetAllocator *>(context);
+        if (budget->remaining_allocations <= 0) {
+            return nullptr;
+        }
+        budget->remaining_allocations--;
+        return realloc(ptr, new_size);
+    }
+
+    static void deallocate(void *, void *ptr, size_t) {
+        free(ptr);
+    }
+
+    ContactAllocator as_allocator() {
+        ContactAllocator allocator = {allocate, reallocate, deallocate, this};
+        return allocator;
+    }
+};
+
+static void require_database_operations(ContactDB *db) {
+    for (int i = 0; i < NUM_OF_TEST_CONTACTS; ++i) {
+        std::string i_str = std::to_string(i);
+        REQUIRE(contact_db_add(db, ("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str()) == CONTACT_OK);
+    }
+    REQUIRE(db->count == NUM_OF_TEST_CONTACTS);
+    REQUIRE(contact_db_add(db, "Name0", "1", "1") == CONTACT_ERR_DUPLICATE);
+
+    // Delete every other contact, the order of the remaining ones has to be kept
+    for (int i = 0; i < NUM_OF_TEST_CONTACTS; i += 2) {
+        REQUIRE(contact_db_delete(db, ("Name" + std::to_string(i)).c_str()) == CONTACT_OK);
+    }
+    REQUIRE(db->count == NUM_OF_TEST_CONTACTS / 2);
+    for (int i = 0; i < db->count; ++i) {
+        REQUIRE(strcmp(db->contacts[i]->name, ("Name" + std::to_string(2 * i + 1)).c_str()) == 0);
+    }
+    REQUIRE(contact_db_search(db, "Name0") == nullptr);
+    Contact *found_contact = contact_db_search(db, "Name1");
+    REQUIRE(found_contact != nullptr);
+    REQUIRE(strcmp(found_contact->email, "testemail1@gmail.com") == 0);
+    REQUIRE(contact_db_delete(db, "Name0") == CONTACT_ERR_NOT_FOUND);
+
+    // Deleted names can be added again
+    REQUIRE(contact_db_add(db, "Name0", "+3701230", "testemail0@gmail.com") == CONTACT_OK);
+    REQUIRE(strcmp(db->contacts[db->count - 1]->name, "Name0") == 0);
+
+    contact_db_free(db);
+    REQUIRE(db->count == 0);
+    REQUIRE(db->contacts == nullptr);
+}
+
+// ==========================
+// = UNIT TESTS: contact_db =
+// ==========================
+
+TEST_CASE("Contact database system allocator test", "[contact_db]") {
+    ContactDB db;
+    REQUIRE(contact_db_init(&db, nullptr) == CONTACT_OK);
+    require_database_operations(&db);
+}
+
+TEST_CASE("Contact database arena allocator test", "[contact_db]") {
+    ArenaAllocator *arena = arena_create(1 << 16);
+    REQUIRE(arena != nullptr);
+    ContactAllocator allocator = arena_as_allocator(arena);
+
+    ContactDB db;
+    REQUIRE(contact_db_init(&db, &allocator) == CONTACT_OK);
+    require_database_operations(&db);
+
+    arena_destroy(arena);
+}
+
+TEST_CASE("Contact database pool allocator test", "[contact_db]") {
+    PoolAllocator *pool = pool_create(sizeof(Contact), 256);
+    REQUIRE(pool != nullptr);
+    ContactAllocator allocator = pool_as_allocator(pool);
+
+    ContactDB db;
+    REQUIRE(contact_db_init(&db, &allocator) == CONTACT_OK);
+    require_database_operations(&db);
+
+    pool_destroy(pool);
+}
+
+// Allocation failures are reported as an error code, and leave the database as it was
+TEST_CASE("Contact database allocation failure test", "[contact_db]") {
+    BudgetAllocator budget = {4};
+    ContactAllocator allocator = budget.as_allocator();
+
+    ContactDB db;
+    REQUIRE(contact_db_init(&db, &allocator) == CONTACT_OK);
+    // The first contact needs the pointer array, the name index and the contact itself
+    REQUIRE(contact_db_add(&db, "First", "1", "first@gmail.com") == CONTACT_OK);
+    REQUIRE(contact_db_add(&db, "Second", "2", "second@gmail.com") == CONTACT_OK);
+    REQUIRE(contact_db_add(&db, "Third", "3", "third@gmail.com") == CONTACT_ERR_NO_MEMORY);
+    REQUIRE(db.count == 2);
+    REQUIRE(contact_db_search(&db, "Third") == nullptr);
+    REQUIRE(strcmp(db.contacts[1]->name, "Second") == 0);
+
+    // Deleting needs no memory
+    REQUIRE(contact_db_delete(&db, "First") == CONTACT_OK);
+    budget.remaining_allocations = 1;
+    REQUIRE(contact_db_add(&db, "Third", "3", "third@gmail.com") == CONTACT_OK);
+    REQUIRE(db.count == 2);
+
+    contact_db_free(&db);
+}
+
+// A snapshot replaces the contents of the copy, and tells which event of the source it reflects
+TEST_CASE("Contact database snapshot test", "[contact_db]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source, copy;
+    contact_db_init(&source, nullptr);
+    contact_db_attach_feed(&source, feed);
+    BudgetAllocator budget = {3};
+    ContactAllocator allocator = budget.as_allocator();
+    contact_db_init(&copy, &allocator);
+    REQUIRE(contact_db_add(&copy, "Old", "0", "old@gmail.com") == CONTACT_OK);
+
+    for (int i = 0; i < 3; ++i) {
+        std::string i_str = std::to_string(i);
+        REQUIRE(contact_db_add(&source, ("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str()) == CONTACT_OK);
+    }
+    REQUIRE(contact_db_delete(&source, "Name1") == CONTACT_OK);
+
+    // Running out of memory halfway (here for the name index) keeps the old contents
+    uint64_t head_seq = 0;
+    budget.remaining_allocations = 3;
+    REQUIRE(contact_db_snapshot(&source, &copy, &head_seq) == CONTACT_ERR_NO_MEMORY);
+    REQUIRE(copy.count == 1);
+    REQUIRE(strcmp(copy.contacts[0]->name, "Old") == 0);
+    REQUIRE(head_seq == 0);
+
+    budget.remaining_allocations = 4;
+    REQUIRE(contact_db_snapshot(&source, &copy, &head_seq) == CONTACT_OK);
+    REQUIRE(head_seq == 4);
+    REQUIRE(copy.count == 2);
+    REQUIRE(strcmp(copy.contacts[0]->name, "Name0") == 0);
+    REQUIRE(strcmp(copy.contacts[1]->name, "Name2") == 0);
+    REQUIRE(strcmp(copy.contacts[1]->email, "testemail2@gmail.com") == 0);
+    REQUIRE(contact_db_search(&copy, "Name2") == copy.contacts[1]);
+    REQUIRE(contact_db_search(&copy, "Old") == nullptr);
+    // The copy is a regular database, and the copied contacts were not published again
+    budget.remaining_allocations = 2;
+    REQUIRE(contact_db_add(&copy, "Name3", "3", "3@gmail.com") == CONTACT_OK);
+    REQUIRE(change_feed_head(feed) == 4);
+
+    contact_db_free(&source);
+    REQUIRE(contact_db_snapshot(&source, &copy, nullptr) == CONTACT_OK);
+    REQUIRE(copy.count == 0);
+
+    contact_db_free(&copy);
+    change_feed_destroy(feed);
+}
+
+// The handle reads and writes the same file format as the legacy database
+TEST_CASE("Contact database file test", "[contact_db]") {
+    const char *test_file = "test_contact_db.txt";
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+    for (int i = 0; i < NUM_OF_TEST_CONTACTS; ++i) {
+        std::string i_str = std::to_string(i);
+        REQUIRE(contact_db_add(&db, ("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str()) == CONTACT_OK);
+    }
+    REQUIRE(contact_db_save_to_file(&db, test_file) == 0);
+
+    ContactDB loaded;
+    contact_db_init(&loaded, nullptr);
+    REQUIRE(contact_db_load_from_file(&loaded, test_file) == CONTACT_OK);
+    REQUIRE(loaded.count == NUM_OF_TEST_CONTACTS);
+    for (int i = 0; i < loaded.count; ++i) {
+        REQUIRE(strcmp(loaded.contacts[i]->name, db.contacts[i]->name) == 0);
+        REQUIRE(strcmp(loaded.contacts[i]->phone, db.contacts[i]->phone) == 0);
+        REQUIRE(strcmp(loaded.contacts[i]->email, db.contacts[i]->email) == 0);
+    }
+    // Loading the same contacts again runs into the duplicates
+    REQUIRE(contact_db_load_from_file(&loaded, test_file) == CONTACT_ERR_DUPLICATE);
+    REQUIRE(loaded.count == NUM_OF_TEST_CONTACTS);
+
+    contact_db_free(&db);
+    contact_db_free(&loaded);
+    remove(test_file);
+}
+
+// A file that cannot be loaded is reported as a status, keeping the contacts loaded before the failure
+TEST_CASE("Contact database invalid file test", "[contact_db]") {
+    const char *test_file = "test_contact_db_invalid.txt";
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+
+    // A missing file is an empty database, and is not created
+    REQUIRE(contact_db_load_from_file(&db, test_file) == CONTACT_OK);
+    REQUIRE(db.count == 0);
+    REQUIRE(fopen(test_file, "r") == nullptr);
+
+    // Line breaks of any style are stripped, and the last line break is optional
+    FILE *file = fopen(test_file, "w");
+    REQUIRE(file != nullptr);
+    fputs("Name0\r\n+3701230\r\ntestemail0@gmail.com\r\nName1\n+3701231\ntestemail1@gmail.com", file);
+    fclose(file);
+    REQUIRE(contact_db_load_from_file(&db, test_file) == CONTACT_OK);
+    REQUIRE(db.count == 2);
+    REQUIRE(strcmp(db.contacts[0]->phone, "+3701230") == 0);
+    REQUIRE(strcmp(db.contacts[1]->email, "testemail1@gmail.com") == 0);
+    contact_db_free(&db);
+
+    // A contact cut off by the end of the file
+    file = fopen(test_file, "w");
+    REQUIRE(file != nullptr);
+    fputs("Name0\n+3701230\ntestemail0@gmail.com\nName1\n+3701231\n", file);
+    fclose(file);
+    REQUIRE(contact_db_load_from_file(&db, test_file) == CONTACT_ERR_INVALID);
+    REQUIRE(db.count == 1);
+    contact_db_free(&db);
+
+    // A phone number longer than MAX_PHONELEN
+    file = fopen(test_file, "w");
+    REQUIRE(file != nullptr);
+    fputs("Name0\n+37012345678901234567890\ntestemail0@gmail.com\n", file);
+    fclose(file);
+    REQUIRE(contact_db_load_from_file(&db, test_file) == CONTACT_ERR_INVALID);
+    REQUIRE(db.count == 0);
+    remove(test_file);
+
+    // A directory can be opened but not read
+    REQUIRE(contact_db_load_from_file(&db, ".") == CONTACT_ERR_IO);
+    REQUIRE(db.count == 0);
+    REQUIRE(strcmp(contact_status_message(CONTACT_ERR_IO), "Failed to read or write the file") == 0);
+
+    contact_db_free(&db);
+}
+
+// Set different values of the input to null or invalid data
+TEST_CASE("Contact database null test", "[contact_db]") {
+    ContactDB db;
+    REQUIRE(contact_db_init(nullptr, nullptr) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_init(&db, nullptr) == CONTACT_OK);
+
+    REQUIRE(contact_db_add(nullptr, "test", "test", "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_add(&db, nullptr, "test", "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_add(&db, "test", "", "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_add(&db, "test", "1234567890123456", "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_add(&db, "test", "test", "some\nemail@gmail.com") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_search(nullptr, "test") == nullptr);
+    REQUIRE(contact_db_search(&db, nullptr) == nullptr);
+    REQUIRE(contact_db_delete(nullptr, "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_delete(&db, "test") == CONTACT_ERR_NOT_FOUND);
+    REQUIRE(db.count == 0);
+
+    REQUIRE(contact_db_snapshot(nullptr, &db, nullptr) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_snapshot(&db, nullptr, nullptr) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_snapshot(&db, &db, nullptr) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_load_from_file(nullptr, "test") == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_load_from_file(&db, nullptr) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_save_to_file(nullptr, "test") == 1);
+    REQUIRE(contact_db_save_to_file(&db, nullptr) == 1);
+
+    REQUIRE(strcmp(contact_status_message(CONTACT_ERR_NO_MEMORY), "Failed to allocate memory") == 0);
+    contact_db_free(nullptr);
+    contact_db_free(&db);
+}
@@ -0,0 +1,396 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "change_feed.h"
+#include "contacts.h"
+#include "import_export.h"
+}
+
+#define NUM_OF_EXPORTED_CONTACTS 1000
+
+static const char *import_test_file = "test_import_export_db.txt";
+
+static void write_test_file(const std::string &content) {
+    FILE *file = fopen(import_test_file, "wb");
+    REQUIRE(file != nullptr);
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+}
+
+static Contact *import_test_file_contents(const std::string &content, ContactFormat format, int *contact_count,
+                                          ImportReport *report) {
+    write_test_file(content);
+    *contact_count = 0;
+    Contact *database = import_contacts(nullptr, contact_count, import_test_file, format, report);
+    remove(import_test_file);
+    return database;
+}
+
+class ExportFixture {
+public:
+    ExportFixture() {
+        for (int i = 0; i < NUM_OF_EXPORTED_CONTACTS; ++i) {
+            std::string i_str = std::to_string(i);
+            // Every few contacts contain characters that have to be quoted or escaped in some format
+            std::string name = (i % 3 == 0) ? "Doe, \"Johnny\"; Jr\\" + i_str : "Name" + i_str;
+            if (i % 7 == 0) {
+                name += " \xC5\xBD\xC4\x97ra"; // non-ASCII letters
+            }
+            database = add_contact(name.c_str(), ("+370123" + i_str).c_str(),
+                                   ("testemail" + i_str + "@gmail.com").c_str(), database, &contact_count);
+        }
+        Contact large_contact;
+        strcpy(large_contact.name, std::string(MAX_NAMELEN, 'n').c_str());
+        strcpy(large_contact.phone, std::string(MAX_PHONELEN, 'p').c_str());
+        strcpy(large_contact.email, std::string(MAX_EMAILLEN, 'e').c_str());
+        database = add_contact(large_contact.name, large_contact.phone, large_contact.email, database,
+                               &contact_count);
+    }
+
+    ~ExportFixture() {
+        free(database);
+    }
+
+    void require_roundtrip(ContactFormat format) {
+        REQUIRE(export_contacts(database, contact_count, import_test_file, format) == 0);
+
+        int imported_count = 0;
+        ImportReport report;
+        Contact *imported = import_contacts(nullptr, &imported_count, import_test_file, format, &report);
+        remove(import_test_file);
+
+        REQUIRE(report.error_flag == 0);
+        REQUIRE(report.skipped == 0);
+        REQUIRE(report.imported == contact_count);
+        REQUIRE(imported_count == contact_count);
+        for (int i = 0; i < contact_count; ++i) {
+            REQUIRE(strcmp(imported[i].name, database[i].name) == 0);
+            REQUIRE(strcmp(imported[i].phone, database[i].phone) == 0);
+            REQUIRE(strcmp(imported[i].email, database[i].email) == 0);
+        }
+        free(imported);
+    }
+
+    // The same roundtrip through a contact database handle
+    void require_db_roundtrip(ContactFormat format) {
+        ContactDB exported;
+        contact_db_init(&exported, nullptr);
+        for (int i = 0; i < contact_count; ++i) {
+            REQUIRE(contact_db_add(&exported, database[i].name, database[i].phone, database[i].email) == CONTACT_OK);
+        }
+        REQUIRE(contact_db_export(&exported, import_test_file, format) == 0);
+
+        ContactDB imported;
+        contact_db_init(&imported, nullptr);
+        ImportReport report;
+        REQUIRE(contact_db_import(&imported, import_test_file, format, &report) == CONTACT_OK);
+        remove(import_test_file);
+
+        REQUIRE(report.error_flag == 0);
+        REQUIRE(report.skipped == 0);
+        REQUIRE(report.imported == contact_count);
+        REQUIRE(imported.count == contact_count);
+        for (int i = 0; i < contact_count; ++i) {
+            REQUIRE(strcmp(imported.contacts[i]->name, database[i].name) == 0);
+            REQUIRE(strcmp(imported.contacts[i]->phone, database[i].phone) == 0);
+            REQUIRE(strcmp(imported.contacts[i]->email, database[i].email) == 0);
+        }
+        contact_db_free(&exported);
+        contact_db_free(&imported);
+    }
+
+    Contact *database = nullptr;
+    int contact_count = 0;
+};
+
+// =============================
+// = UNIT TESTS: export/import =
+// =============================
+
+TEST_CASE_METHOD(ExportFixture, "CSV roundtrip test", "[import_export]") {
+    require_roundtrip(CONTACT_FORMAT_CSV);
+}
+
+TEST_CASE_METHOD(ExportFixture, "vCard 3.0 roundtrip test", "[import_export]") {
+    require_roundtrip(CONTACT_FORMAT_VCARD3);
+}
+
+TEST_CASE_METHOD(ExportFixture, "vCard 4.0 roundtrip test", "[import_export]") {
+    require_roundtrip(CONTACT_FORMAT_VCARD4);
+}
+
+TEST_CASE_METHOD(ExportFixture, "JSON Lines roundtrip test", "[import_export]") {
+    require_roundtrip(CONTACT_FORMAT_JSONL);
+}
+
+// Contacts already in the database are kept, and their names cannot be imported again
+TEST_CASE("Import into existing database test", "[import_export]") {
+    Contact *database = nullptr;
+    int contact_count = 0;
+    database = add_contact("Existing", "123", "existing@gmail.com", database, &contact_count);
+
+    write_test_file("name,phone,email\nNew,456,new@gmail.com\nExisting,789,other@gmail.com\nNew,000,x@y.z\n");
+    ImportReport report;
+    database = import_contacts(database, &contact_count, import_test_file, CONTACT_FORMAT_CSV, &report);
+    remove(import_test_file);
+
+    REQUIRE(contact_count == 2);
+    REQUIRE(report.imported == 1);
+    REQUIRE(report.skipped == 2);
+    REQUIRE(report.first_error_line == 3);
+    REQUIRE(strcmp(database[0].phone, "123") == 0);
+    REQUIRE(strcmp(database[1].name, "New") == 0);
+    REQUIRE(search_contact("New", database, contact_count) == &database[1]);
+
+    free(database);
+}
+
+TEST_CASE_METHOD(ExportFixture, "Contact database roundtrip test", "[import_export]") {
+    require_db_roundtrip(CONTACT_FORMAT_CSV);
+    require_db_roundtrip(CONTACT_FORMAT_VCARD3);
+    require_db_roundtrip(CONTACT_FORMAT_VCARD4);
+    require_db_roundtrip(CONTACT_FORMAT_JSONL);
+}
+
+// Imported contacts are added through the handle, so they are indexed by name and published to its feed
+TEST_CASE("Import into contact database test", "[import_export]") {
+    ChangeFeed *feed = change_feed_create(64);
+    REQUIRE(feed != nullptr);
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+    contact_db_attach_feed(&db, feed);
+    REQUIRE(contact_db_add(&db, "Existing", "123", "existing@gmail.com") == CONTACT_OK);
+
+    write_test_file("name,phone,email\nNew,456,new@gmail.com\nExisting,789,other@gmail.com\n"
+                    "New,000,x@y.z\nNoEmail,1,\nOther,789,other@gmail.com\n");
+    ImportReport report;
+    REQUIRE(contact_db_import(&db, import_test_file, CONTACT_FORMAT_CSV, &report) == CONTACT_OK);
+    remove(import_test_file);
+
+    REQUIRE(report.imported == 2);
+    REQUIRE(report.skipped == 3);
+    REQUIRE(report.first_error_line == 3);
+    REQUIRE(report.error_flag == 0);
+    REQUIRE(db.count == 3);
+    REQUIRE(strcmp(contact_db_search(&db, "Existing")->phone, "123") == 0);
+    REQUIRE(contact_db_search(&db, "New") == db.contacts[1]);
+    REQUIRE(contact_db_search(&db, "Other") == db.contacts[2]);
+
+    // Every imported contact is an event of its own
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 1);
+    ChangeEvent event;
+    const char *imported_names[] = {"New", "Other"};
+    for (const char *name : imported_names) {
+        REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_OK);
+        REQUIRE(event.type == CHANGE_ADD);
+        REQUIRE(strcmp(event.contact.name, name) == 0);
+    }
+    REQUIRE(change_subscriber_poll(&subscriber, &event) == CHANGE_FEED_EMPTY);
+
+    contact_db_free(&db);
+    change_feed_destroy(feed);
+}
+
+// ============================
+// = UNIT TESTS: CSV importer =
+// ============================
+
+// Columns are mapped by the header, and bad rows are skipped without stopping the import
+TEST_CASE("CSV import validation test", "[import_export]") {
+    int contact_count = 0;
+    ImportReport report;
+    Contact *database = import_test_file_contents(
+            "\xEF\xBB\xBF" "Email,Notes,Name,Phone\r\n"
+            "a@b.c,some notes,Alice,111\r\n"
+            ",,Empty email,222\r\n"
+            "\r\n"
+            "c@d.e,,Missing phone\r\n"
+            "e@f.g,\"multi\nline\",\"Bob \"\"the\"\" builder\",333\r\n"
+            "f@g.h,,Carol,1234567890123456\r\n"
+            "g@h.i,,\"Dave\"x,444\r\n"
+            "h@i.j,,Erin,555\r\n",
+            CONTACT_FORMAT_CSV, &contact_count, &report);
+
+    REQUIRE(report.error_flag == 0);
+    REQUIRE(report.imported == 3);
+    REQUIRE(report.skipped == 4);
+    REQUIRE(report.first_error_line == 3);
+    REQUIRE(contact_count == 3);
+    REQUIRE(strcmp(database[0].name, "Alice") == 0);
+    REQUIRE(strcmp(database[0].email, "a@b.c") == 0);
+    REQUIRE(strcmp(database[1].name, "Bob \"the\" builder") == 0);
+    REQUIRE(strcmp(database[1].phone, "333") == 0);
+    REQUIRE(strcmp(database[2].name, "Erin") == 0);
+
+    free(database);
+}
+
+// Without a header the columns are expected in the name, phone, email order
+TEST_CASE("CSV import without header test", "[import_export]") {
+    int contact_count = 0;
+    ImportReport report;
+    Contact *database = import_test_file_contents("Alice,111,a@b.c\nBob,222,b@c.d,extra\n\"Carol\nX,333,c@d.e\n",
+                                                  CONTACT_FORMAT_CSV, &contact_count, &report);
+
+    REQUIRE(report.imported == 2);
+    REQUIRE(report.skipped == 1);
+    REQUIRE(report.first_error_line == 3);
+    REQUIRE(strcmp(database[1].email, "b@c.d") == 0);
+
+    free(database);
+}
+
+// ==============================
+// = UNIT TESTS: vCard importer =
+// ==============================
+
+TEST_CASE("vCard import test", "[import_export]") {
+    int contact_count = 0;
+    ImportReport report;
+    Contact *database = import_test_file_contents(
+            "BEGIN:VCARD\r\n"
+            "VERSION:4.0\r\n"
+            "FN:Alice \r\n"
+            " Smith\r\n"
+            "PHOTO:data:image/jpeg;base64,AAAA\r\n"
+            " BBBB\r\n"
+            "TEL;TYPE=\"work,voice\";VALUE=uri:tel:+1-555-0100\r\n"
+            "TEL:+1-555-0199\r\n"
+            "item1.EMAIL;TYPE=work:alice@example.com\r\n"
+            "END:VCARD\r\n"
+            "BEGIN:VCARD\r\n"
+            "VERSION:3.0\r\n"
+            "N:Builder;Bob;;;\r\n"
+            "TEL:222\r\n"
+            "EMAIL:bob@example.com\r\n"
+            "END:VCARD\r\n"
+            "BEGIN:VCARD\r\n"
+            "VERSION:3.0\r\n"
+            "FN:No Email\r\n"
+            "TEL:333\r\n"
+            "END:VCARD\r\n"
+            "BEGIN:VCARD\r\n"
+            "FN:Unterminated\r\n"
+            "BEGIN:VCARD\r\n"
+            "FN:Carol\\, the \\;great\\;\r\n"
+            "TEL:444\r\n"
+            "EMAIL:carol@example.com\r\n"
+            "END:VCARD\r\n",
+            CONTACT_FORMAT_VCARD4, &contact_count, &report);
+
+    REQUIRE(report.imported == 3);
+    REQUIRE(report.skipped == 2);
+    REQUIRE(report.first_error_line == 17);
+    REQUIRE(strcmp(database[0].name, "Alice Smith") == 0);
+    REQUIRE(strcmp(database[0].phone, "+1-555-0100") == 0);
+    REQUIRE(strcmp(database[0].email, "alice@example.com") == 0);
+    REQUIRE(strcmp(database[1].name, "Bob Builder") == 0);
+    REQUIRE(strcmp(database[2].name, "Carol, the ;great;") == 0);
+
+    free(database);
+}
+
+// ===================================
+// = UNIT TESTS: JSON Lines importer =
+// ===================================
+
+TEST_CASE("JSON Lines import test", "[import_export]") {
+    int contact_count = 0;
+    ImportReport report;
+    Contact *database = import_test_file_contents(
+            "{\"name\": \"Alice\", \"phone\": \"111\", \"email\": \"a@b.c\", \"tags\": [\"x\", {\"y\": 1}], \"age\": 3}\n"
+            "\n"
+            "{\"name\": \"Bob\", \"phone\": 222, \"email\": \"b@c.d\"}\n"
+            "{\"name\": \"Carol\", \"phone\": \"333\"\n"
+            "not json\n"
+            "{\"name\": \"\\u017D\\u0117ra \\ud83d\\ude00\", \"phone\": \"444\", \"email\": \"c\\/d@e.f\"}\n"
+            "{\"name\": \"Line\\nbreak\", \"phone\": \"555\", \"email\": \"g@h.i\"}\n"
+            "  {\"email\": \"x@y.z\", \"phone\": \"666\", \"name\": \"Dave\", \"name\": \"Dan\"}  \n",
+            CONTACT_FORMAT_JSONL, &contact_count, &report);
+
+    REQUIRE(report.imported == 3);
+    REQUIRE(report.skipped == 4);
+    REQUIRE(report.first_error_line == 3);
+    REQUIRE(strcmp(database[0].name, "Alice") == 0);
+    REQUIRE(strcmp(database[1].name, "\xC5\xBD\xC4\x97ra \xF0\x9F\x98\x80") == 0);
+    REQUIRE(strcmp(database[1].email, "c/d@e.f") == 0);
+    REQUIRE(strcmp(database[2].name, "Dan") == 0);
+
+    free(database);
+}
+
+// NUL characters would cut the C strings short, so fields containing them are rejected in every format
+TEST_CASE("NUL character import test", "[import_export]") {
+    const std::string nul(1, '\0');
+    int contact_count = 0;
+    ImportReport report;
+    Contact *database = import_test_file_contents(
+            "{\"name\": \"ab\\u0000cd\", \"phone\": \"111\", \"email\": \"a@b.c\"}\n"
+            "{\"name\": \"Alice\", \"phone\": \"222\", \"email\": \"b@c.d\"}\n"
+            "{\"name\": \"Bob\", \"phone\": \"333\", \"email\": \"c@d.e\"}" + nul + "junk\n",
+            CONTACT_FORMAT_JSONL, &contact_count, &report);
+    REQUIRE(report.imported == 1);
+    REQUIRE(report.skipped == 2);
+    REQUIRE(report.first_error_line == 1);
+    REQUIRE(strcmp(database[0].name, "Alice") == 0);
+    free(database);
+
+    database = import_test_file_contents("Alice,111,a@b.c\nB" + nul + "ob,222,b@c.d\n",
+                                         CONTACT_FORMAT_CSV, &contact_count, &report);
+    REQUIRE(report.imported == 1);
+    REQUIRE(report.skipped == 1);
+    REQUIRE(report.first_error_line == 2);
+    free(database);
+
+    database = import_test_file_contents(
+            "BEGIN:VCARD\r\nFN:Car" + nul + "ol\r\nTEL:444\r\nEMAIL:c@d.e\r\nEND:VCARD\r\n",
+            CONTACT_FORMAT_VCARD3, &contact_count, &report);
+    REQUIRE(report.imported == 0);
+    REQUIRE(report.skipped == 1);
+    REQUIRE(contact_count == 0);
+    free(database);
+}
+
+// Set different values of the input to null or out of range
+TEST_CASE("Import/export null test", "[import_export]") {
+    int contact_count = 0;
+    ImportReport report;
+
+    REQUIRE(import_contacts(nullptr, &contact_count, nullptr, CONTACT_FORMAT_CSV, &report) == nullptr);
+    REQUIRE(report.error_flag == 1);
+    REQUIRE(import_contacts(nullptr, &contact_count, "nonexistent/file.csv", CONTACT_FORMAT_CSV, &report) == nullptr);
+    REQUIRE(report.error_flag == 1);
+    REQUIRE(import_contacts_from_stream(nullptr, nullptr, stdin, "stdin", CONTACT_FORMAT_CSV, &report) == nullptr);
+    REQUIRE(report.error_flag == 1);
+    REQUIRE(contact_count == 0);
+
+    REQUIRE(export_contacts(nullptr, 1, import_test_file, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(export_contacts(nullptr, 0, nullptr, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(export_contacts_to_stream(nullptr, 0, nullptr, CONTACT_FORMAT_JSONL) == 1);
+    REQUIRE(export_contacts(nullptr, 0, import_test_file, CONTACT_FORMAT_JSONL) == 0);
+    remove(import_test_file);
+
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+    REQUIRE(contact_db_import(nullptr, import_test_file, CONTACT_FORMAT_CSV, &report) == CONTACT_ERR_INVALID);
+    REQUIRE(report.error_flag == 1);
+    REQUIRE(contact_db_import(&db, nullptr, CONTACT_FORMAT_CSV, &report) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_import(&db, "nonexistent/file.csv", CONTACT_FORMAT_CSV, &report) == CONTACT_ERR_IO);
+    REQUIRE(report.error_flag == 1);
+    REQUIRE(contact_db_import_from_stream(&db, nullptr, "stdin", CONTACT_FORMAT_CSV, &report) == CONTACT_ERR_INVALID);
+    REQUIRE(contact_db_import_from_stream(&db, stdin, "stdin", (ContactFormat) 42, &report) == CONTACT_ERR_INVALID);
+    REQUIRE(db.count == 0);
+
+    REQUIRE(contact_db_export(nullptr, import_test_file, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(contact_db_export(&db, nullptr, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(contact_db_export_to_stream(&db, nullptr, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(contact_db_export_to_stream(nullptr, stdout, CONTACT_FORMAT_CSV) == 1);
+    REQUIRE(contact_db_export(&db, import_test_file, CONTACT_FORMAT_JSONL) == 0);
+    remove(import_test_file);
+    contact_db_free(&db);
+}
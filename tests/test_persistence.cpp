@@ -0,0 +1,254 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "contacts.h"
+#include "persistence.h"
+}
+
+#define NUM_OF_PERSISTED_CONTACTS 100
+
+static const char *persistence_test_file = "test_persistence_db.txt";
+
+static Contact *build_database(int contact_count) {
+    Contact *database = nullptr;
+    int count = 0;
+    for (int i = 0; i < contact_count; ++i) {
+        std::string i_str = std::to_string(i);
+        database = add_contact(("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str(), database, &count);
+    }
+    return database;
+}
+
+static int count_saved_contacts(Contact **loaded_database) {
+    Contact *database = nullptr;
+    int contact_count = 0;
+    database = load_contacts_from_file(database, &contact_count, persistence_test_file);
+    if (loaded_database != nullptr) {
+        *loaded_database = database;
+    } else {
+        free(database);
+    }
+    return contact_count;
+}
+
+// ===============================
+// = UNIT TESTS: persister_flush =
+// ===============================
+
+// Flush has to write everything submitted before it
+TEST_CASE("Persister flush test", "[persistence]") {
+    remove(persistence_test_file);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    // A long interval, so only the flush can trigger the save
+    Persister *persister = persister_start(persistence_test_file, 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+    REQUIRE(persister_flush(persister) == 0);
+
+    Contact *loaded_database = nullptr;
+    REQUIRE(count_saved_contacts(&loaded_database) == NUM_OF_PERSISTED_CONTACTS);
+    for (int i = 0; i < NUM_OF_PERSISTED_CONTACTS; ++i) {
+        REQUIRE(strcmp(loaded_database[i].name, database[i].name) == 0);
+        REQUIRE(strcmp(loaded_database[i].phone, database[i].phone) == 0);
+        REQUIRE(strcmp(loaded_database[i].email, database[i].email) == 0);
+    }
+
+    REQUIRE(persister_stop(persister) == 0);
+    free(loaded_database);
+    free(database);
+    remove(persistence_test_file);
+}
+
+// The submitted snapshot must not be affected by later changes to the database
+TEST_CASE("Persister snapshot test", "[persistence]") {
+    remove(persistence_test_file);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+    int contact_count = NUM_OF_PERSISTED_CONTACTS;
+
+    Persister *persister = persister_start(persistence_test_file, 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, contact_count) == 0);
+    for (int i = 0; i < NUM_OF_PERSISTED_CONTACTS / 2; ++i) {
+        Contact *updated_database = delete_contact(("Name" + std::to_string(i)).c_str(), database, &contact_count);
+        REQUIRE(updated_database != nullptr);
+        database = updated_database;
+    }
+    REQUIRE(persister_flush(persister) == 0);
+    REQUIRE(count_saved_contacts(nullptr) == NUM_OF_PERSISTED_CONTACTS);
+
+    // The newer snapshot replaces the older one
+    REQUIRE(persister_submit(persister, database, contact_count) == 0);
+    REQUIRE(persister_flush(persister) == 0);
+    REQUIRE(count_saved_contacts(nullptr) == NUM_OF_PERSISTED_CONTACTS / 2);
+
+    REQUIRE(persister_stop(persister) == 0);
+    free(database);
+    remove(persistence_test_file);
+}
+
+// =================================
+// = UNIT TESTS: autosave interval =
+// =================================
+
+// Without any flush, the snapshot has to be saved once the interval runs out
+TEST_CASE("Persister autosave test", "[persistence]") {
+    remove(persistence_test_file);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    Persister *persister = persister_start(persistence_test_file, 20);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+
+    int saved_count = 0;
+    for (int attempt = 0; attempt < 100 && saved_count != NUM_OF_PERSISTED_CONTACTS; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        saved_count = count_saved_contacts(nullptr);
+    }
+    REQUIRE(saved_count == NUM_OF_PERSISTED_CONTACTS);
+
+    REQUIRE(persister_stop(persister) == 0);
+    free(database);
+    remove(persistence_test_file);
+}
+
+// Stopping the persister has to save the pending snapshot, however long the interval is
+TEST_CASE("Persister stop test", "[persistence]") {
+    remove(persistence_test_file);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    Persister *persister = persister_start(persistence_test_file, 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+    REQUIRE(persister_stop(persister) == 0);
+    REQUIRE(count_saved_contacts(nullptr) == NUM_OF_PERSISTED_CONTACTS);
+
+    free(database);
+    remove(persistence_test_file);
+}
+
+// A failed save keeps the snapshot pending, and it is written on a later interval without another submission
+TEST_CASE("Persister retry test", "[persistence]") {
+    const char *retry_dir = "test_persistence_dir";
+    const char *retry_file = "test_persistence_dir/db.txt";
+    rmdir(retry_dir);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    Persister *persister = persister_start(retry_file, 20);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+    REQUIRE(persister_flush(persister) == 1);
+
+    REQUIRE(mkdir(retry_dir, 0755) == 0);
+    int saved_flag = 0;
+    for (int attempt = 0; attempt < 100 && !saved_flag; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        saved_flag = access(retry_file, F_OK) == 0;
+    }
+    REQUIRE(saved_flag);
+    REQUIRE(persister_flush(persister) == 0);
+    REQUIRE(persister_stop(persister) == 0);
+
+    Contact *loaded_database = nullptr;
+    int loaded_count = 0;
+    loaded_database = load_contacts_from_file(loaded_database, &loaded_count, retry_file);
+    REQUIRE(loaded_count == NUM_OF_PERSISTED_CONTACTS);
+
+    free(loaded_database);
+    free(database);
+    remove(retry_file);
+    rmdir(retry_dir);
+}
+
+// Flushing does not wait for the interval to retry a failed save
+TEST_CASE("Persister flush retry test", "[persistence]") {
+    const char *retry_dir = "test_persistence_dir";
+    const char *retry_file = "test_persistence_dir/db.txt";
+    rmdir(retry_dir);
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    Persister *persister = persister_start(retry_file, 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+    REQUIRE(persister_flush(persister) == 1);
+    REQUIRE(mkdir(retry_dir, 0755) == 0);
+    REQUIRE(persister_flush(persister) == 0);
+    REQUIRE(access(retry_file, F_OK) == 0);
+    REQUIRE(persister_stop(persister) == 0);
+
+    free(database);
+    remove(retry_file);
+    rmdir(retry_dir);
+}
+
+// The final save is attempted once more on stop, and its failure is reported
+TEST_CASE("Persister stop failure test", "[persistence]") {
+    Contact *database = build_database(NUM_OF_PERSISTED_CONTACTS);
+
+    Persister *persister = persister_start("test_persistence_missing_dir/db.txt", 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, database, NUM_OF_PERSISTED_CONTACTS) == 0);
+    REQUIRE(persister_flush(persister) == 1);
+    REQUIRE(persister_stop(persister) == 1);
+
+    free(database);
+}
+
+// A database handle is saved the same way as the legacy array
+TEST_CASE("Persister database handle test", "[persistence]") {
+    remove(persistence_test_file);
+    ContactDB db;
+    contact_db_init(&db, nullptr);
+    for (int i = 0; i < NUM_OF_PERSISTED_CONTACTS; ++i) {
+        std::string i_str = std::to_string(i);
+        REQUIRE(contact_db_add(&db, ("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str()) == CONTACT_OK);
+    }
+
+    Persister *persister = persister_start(persistence_test_file, 60000);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit_db(persister, &db) == 0);
+    REQUIRE(contact_db_delete(&db, "Name0") == CONTACT_OK);
+    REQUIRE(persister_submit_db(persister, &db) == 0);
+    REQUIRE(persister_flush(persister) == 0);
+
+    Contact *loaded_database = nullptr;
+    REQUIRE(count_saved_contacts(&loaded_database) == NUM_OF_PERSISTED_CONTACTS - 1);
+    REQUIRE(strcmp(loaded_database[0].name, "Name1") == 0);
+
+    REQUIRE(persister_submit_db(nullptr, &db) == 1);
+    REQUIRE(persister_submit_db(persister, nullptr) == 1);
+    REQUIRE(persister_stop(persister) == 0);
+    free(loaded_database);
+    contact_db_free(&db);
+    remove(persistence_test_file);
+}
+
+// Set different values of the input to null or out of range
+TEST_CASE("Persister null test", "[persistence]") {
+    REQUIRE(persister_start(nullptr, 0) == nullptr);
+    REQUIRE(persister_start(persistence_test_file, -1) == nullptr);
+    REQUIRE(persister_submit(nullptr, nullptr, 0) == 1);
+    REQUIRE(persister_flush(nullptr) == 1);
+    REQUIRE(persister_stop(nullptr) == 1);
+
+    Persister *persister = persister_start(persistence_test_file, 0);
+    REQUIRE(persister != nullptr);
+    REQUIRE(persister_submit(persister, nullptr, 1) == 1);
+    REQUIRE(persister_submit(persister, nullptr, -1) == 1);
+    // An empty database is a valid snapshot
+    REQUIRE(persister_submit(persister, nullptr, 0) == 0);
+    REQUIRE(persister_stop(persister) == 0);
+    REQUIRE(count_saved_contacts(nullptr) == 0);
+
+    remove(persistence_test_file);
+}
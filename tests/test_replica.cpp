@@ -0,0 +1,475 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include "replica.h"
+}
+
+#define NUM_OF_TEST_CONTACTS 500
+
+static const char *journal_file = "test_replica_journal.bin";
+static const char *socket_file = "test_replica.sock";
+static const char *database_file = "test_replica_db.txt";
+
+// Adds contacts to the source, and deletes every third one again
+static void change_source(ContactDB *source, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        std::string i_str = std::to_string(i);
+        REQUIRE(contact_db_add(source, ("Name" + i_str).c_str(), ("+370123" + i_str).c_str(),
+                               ("testemail" + i_str + "@gmail.com").c_str()) == CONTACT_OK);
+        if (i % 3 == 0) {
+            REQUIRE(contact_db_delete(source, ("Name" + std::to_string(i / 3)).c_str()) == CONTACT_OK);
+        }
+    }
+}
+
+static void require_same_contacts(const ContactDB *source, const ContactDB *replica) {
+    REQUIRE(replica->count == source->count);
+    for (int i = 0; i < source->count; ++i) {
+        REQUIRE(strcmp(replica->contacts[i]->name, source->contacts[i]->name) == 0);
+        REQUIRE(strcmp(replica->contacts[i]->phone, source->contacts[i]->phone) == 0);
+        REQUIRE(strcmp(replica->contacts[i]->email, source->contacts[i]->email) == 0);
+    }
+}
+
+// ===============================
+// = UNIT TESTS: replica applier =
+// ===============================
+
+TEST_CASE("Replica catch up test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(4 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+
+    ReplicaApplier applier;
+    REQUIRE(replica_applier_init(&applier, &replica, 0) == CHANGE_FEED_OK);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, applier.applied_seq);
+
+    change_source(&source, 0, NUM_OF_TEST_CONTACTS / 2);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    change_source(&source, NUM_OF_TEST_CONTACTS / 2, NUM_OF_TEST_CONTACTS);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// A replica can be rebuilt from a journal, and resumed from it after a restart
+TEST_CASE("Replica journal test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(4 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    REQUIRE(write_fd >= 0);
+    ChangeSubscriber journal_subscriber;
+    change_subscriber_init(&journal_subscriber, feed, 0);
+
+    change_source(&source, 0, NUM_OF_TEST_CONTACTS / 2);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(read_fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, read_fd);
+    REQUIRE(replica_catch_up_stream(&applier, &reader) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    close(read_fd);
+
+    change_source(&source, NUM_OF_TEST_CONTACTS / 2, NUM_OF_TEST_CONTACTS);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(read_fd >= 0);
+    change_stream_reader_init(&reader, read_fd);
+    REQUIRE(change_stream_seek(&reader, applier.applied_seq) == CHANGE_FEED_OK);
+    REQUIRE(replica_catch_up_stream(&applier, &reader) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+
+    // Reading the journal from the start again changes nothing, the events were already applied
+    REQUIRE(change_stream_seek(&reader, 0) == CHANGE_FEED_OK);
+    REQUIRE(replica_catch_up_stream(&applier, &reader) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// A replica that fell behind the ring is copied from the source, and follows the feed again afterwards
+TEST_CASE("Replica resync test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    change_source(&source, 0, NUM_OF_TEST_CONTACTS / 2);
+    // Without a source, the lost events are only reported
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_OVERRUN);
+    REQUIRE(applier.applied_seq == 0);
+
+    replica_applier_set_source(&applier, &source);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+
+    change_source(&source, NUM_OF_TEST_CONTACTS / 2, NUM_OF_TEST_CONTACTS / 2 + 4);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// The source is copied while another thread keeps changing it, and the copy still matches the event it reflects
+TEST_CASE("Replica concurrent resync test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+
+    // The deletions do not follow the additions right away, so a copy taken between two events would not match
+    const int contact_count = 20 * NUM_OF_TEST_CONTACTS;
+    std::thread producer([&source, contact_count]() {
+        for (int i = 0; i < contact_count; ++i) {
+            std::string i_str = std::to_string(i);
+            contact_db_add(&source, ("Name" + i_str).c_str(), "+370123", "testemail@gmail.com");
+            if (i % 3 == 0) {
+                contact_db_delete(&source, ("Name" + std::to_string(i / 3)).c_str());
+            }
+        }
+    });
+
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    replica_applier_set_source(&applier, &source);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    const uint64_t event_count = contact_count + (contact_count + 2) / 3;
+    while (applier.applied_seq < event_count) {
+        // An inconsistent copy shows up as an event that does not fit the replica
+        REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+        std::this_thread::yield();
+    }
+    producer.join();
+    require_same_contacts(&source, &replica);
+
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// A replica reading a journal recovers from an overrun record the same way
+TEST_CASE("Replica journal resync test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+    int write_fd = open(journal_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    int read_fd = open(journal_file, O_RDONLY);
+    REQUIRE(write_fd >= 0);
+    REQUIRE(read_fd >= 0);
+
+    // The journal loses events to an overrun, and continues after the newest event
+    ChangeSubscriber journal_subscriber;
+    change_subscriber_init(&journal_subscriber, feed, 0);
+    change_source(&source, 0, 4);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    change_source(&source, 4, NUM_OF_TEST_CONTACTS / 2);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OVERRUN);
+    change_subscriber_init(&journal_subscriber, feed, change_feed_head(feed));
+    change_source(&source, NUM_OF_TEST_CONTACTS / 2, NUM_OF_TEST_CONTACTS / 2 + 4);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    replica_applier_set_source(&applier, &source);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, read_fd);
+    REQUIRE(replica_catch_up_stream(&applier, &reader) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+
+    // The events appended after the resynchronization are applied from the journal
+    change_source(&source, NUM_OF_TEST_CONTACTS / 2 + 4, NUM_OF_TEST_CONTACTS / 2 + 8);
+    REQUIRE(change_stream_pump(&journal_subscriber, write_fd, nullptr) == CHANGE_FEED_OK);
+    REQUIRE(replica_catch_up_stream(&applier, &reader) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+
+    close(read_fd);
+    close(write_fd);
+    remove(journal_file);
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// The contact manager attaches a feed before loading its file and serves it, so a replica connected to the socket
+// receives the loaded contacts and every edit made afterwards
+TEST_CASE("Replica socket test", "[replica]") {
+    ContactDB saved;
+    contact_db_init(&saved, nullptr);
+    change_source(&saved, 0, NUM_OF_TEST_CONTACTS / 10);
+    REQUIRE(contact_db_save_to_file(&saved, database_file) == 0);
+    contact_db_free(&saved);
+
+    ChangeFeed *feed = change_feed_create(4 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+    REQUIRE(contact_db_load_from_file(&source, database_file) == CONTACT_OK);
+    ChangeFeedServer *server = change_feed_serve(&source, socket_file);
+    REQUIRE(server != nullptr);
+
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    int fd = change_feed_connect(socket_file, applier.feed_id, applier.applied_seq);
+    REQUIRE(fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, fd);
+
+    change_source(&source, NUM_OF_TEST_CONTACTS / 10, NUM_OF_TEST_CONTACTS);
+    REQUIRE(contact_db_delete(&source, "Name499") == CONTACT_OK);
+    REQUIRE(contact_db_add(&source, "Name499", "499", "499@gmail.com") == CONTACT_OK);
+    while (applier.applied_seq < change_feed_head(feed)) {
+        ChangeEvent event;
+        REQUIRE(change_stream_read(&reader, &event) == CHANGE_FEED_OK);
+        REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OK);
+    }
+    require_same_contacts(&source, &replica);
+
+    close(fd);
+    change_feed_server_stop(server);
+    remove(database_file);
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+}
+
+// After the source restarts with a new feed, the old position of the replica is not mistaken for a position in it
+TEST_CASE("Replica feed restart test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(4 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    ChangeSubscriber subscriber;
+    change_subscriber_init(&subscriber, feed, 0);
+    change_source(&source, 0, NUM_OF_TEST_CONTACTS / 10);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    REQUIRE(applier.feed_id == change_feed_id(feed));
+
+    // The restarted source has published more events than the replica applied, so only the id tells them apart
+    ChangeFeed *new_feed = change_feed_create(4 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(new_feed != nullptr);
+    ContactDB new_source;
+    contact_db_init(&new_source, nullptr);
+    contact_db_attach_feed(&new_source, new_feed);
+    change_source(&new_source, 0, NUM_OF_TEST_CONTACTS / 2);
+    uint64_t applied_seq = applier.applied_seq;
+    change_subscriber_init(&subscriber, new_feed, applier.applied_seq);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_OVERRUN);
+    REQUIRE(applier.applied_seq == applied_seq);
+
+    replica_applier_set_source(&applier, &new_source);
+    REQUIRE(replica_catch_up(&applier, &subscriber) == CHANGE_FEED_EMPTY);
+    require_same_contacts(&new_source, &replica);
+    REQUIRE(applier.feed_id == change_feed_id(new_feed));
+
+    contact_db_free(&source);
+    contact_db_free(&new_source);
+    contact_db_free(&replica);
+    change_feed_destroy(feed);
+    change_feed_destroy(new_feed);
+}
+
+TEST_CASE("Replica gap test", "[replica]") {
+    ContactDB replica;
+    contact_db_init(&replica, nullptr);
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+
+    ChangeEvent event = {};
+    event.seq = 2;
+    event.type = CHANGE_ADD;
+    strcpy(event.contact.name, "Second");
+    strcpy(event.contact.phone, "2");
+    strcpy(event.contact.email, "second@gmail.com");
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OVERRUN);
+    REQUIRE(applier.applied_seq == 0);
+    REQUIRE(replica.count == 0);
+
+    event.seq = 1;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OK);
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OK);
+    REQUIRE(replica.count == 1);
+    REQUIRE(applier.applied_seq == 1);
+
+    contact_db_free(&replica);
+}
+
+// Applies the events of a feed server until the replica reflects the head of the feed, and counts the snapshots
+static int follow_server(ReplicaApplier *applier, ChangeStreamReader *reader, const ChangeFeed *feed) {
+    int snapshot_count = 0;
+    while (applier->applied_seq < change_feed_head(feed) || applier->snapshot_flag) {
+        ChangeEvent event;
+        REQUIRE(change_stream_read(reader, &event) == CHANGE_FEED_OK);
+        if (event.type == CHANGE_SNAPSHOT_BEGIN) {
+            snapshot_count++;
+        }
+        REQUIRE(replica_apply(applier, &event) == CHANGE_FEED_OK);
+    }
+    return snapshot_count;
+}
+
+// The source holds more contacts than the ring holds events, so a replica can only be built from a snapshot,
+// and it gets another one when it stops reading while the source changes
+TEST_CASE("Replica socket snapshot test", "[replica]") {
+    ChangeFeed *feed = change_feed_create(16);
+    REQUIRE(feed != nullptr);
+    ContactDB source, replica;
+    contact_db_init(&source, nullptr);
+    contact_db_init(&replica, nullptr);
+    contact_db_attach_feed(&source, feed);
+    change_source(&source, 0, NUM_OF_TEST_CONTACTS);
+    REQUIRE(source.count > 16);
+    ChangeFeedServer *server = change_feed_serve(&source, socket_file);
+    REQUIRE(server != nullptr);
+
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+    int fd = change_feed_connect(socket_file, applier.feed_id, applier.applied_seq);
+    REQUIRE(fd >= 0);
+    ChangeStreamReader reader;
+    change_stream_reader_init(&reader, fd);
+    REQUIRE(follow_server(&applier, &reader, feed) == 1);
+    require_same_contacts(&source, &replica);
+
+    // Far more events than the socket buffers hold, so the ring is overwritten before the server can send them
+    change_source(&source, NUM_OF_TEST_CONTACTS, 11 * NUM_OF_TEST_CONTACTS);
+    REQUIRE(follow_server(&applier, &reader, feed) >= 1);
+    require_same_contacts(&source, &replica);
+    REQUIRE(applier.applied_seq == change_feed_head(feed));
+    close(fd);
+
+    // A connection that ends in the middle of a snapshot leaves the replica empty rather than incomplete
+    fd = change_feed_connect(socket_file, 0, 0);
+    REQUIRE(fd >= 0);
+    unsigned char records[12 * CHANGE_RECORD_SIZE];
+    size_t received = 0;
+    while (received < sizeof(records)) {
+        ssize_t read_count = read(fd, records + received, sizeof(records) - received);
+        REQUIRE(read_count > 0);
+        received += (size_t) read_count;
+    }
+    close(fd);
+    int pipe_fds[2];
+    REQUIRE(pipe(pipe_fds) == 0);
+    REQUIRE(write(pipe_fds[1], records, sizeof(records)) == (ssize_t) sizeof(records));
+    close(pipe_fds[1]);
+    ContactDB cut_replica;
+    contact_db_init(&cut_replica, nullptr);
+    ReplicaApplier cut_applier;
+    replica_applier_init(&cut_applier, &cut_replica, 0);
+    change_stream_reader_init(&reader, pipe_fds[0]);
+    REQUIRE(replica_catch_up_stream(&cut_applier, &reader) == CHANGE_FEED_CLOSED);
+    REQUIRE(cut_replica.count == 0);
+    REQUIRE(cut_applier.applied_seq == 0);
+    REQUIRE(cut_applier.snapshot_flag == 0);
+    close(pipe_fds[0]);
+
+    change_feed_server_stop(server);
+    contact_db_free(&source);
+    contact_db_free(&replica);
+    contact_db_free(&cut_replica);
+    change_feed_destroy(feed);
+}
+
+// Events that contradict the replica mean it diverged from the source
+TEST_CASE("Replica divergence test", "[replica]") {
+    ContactDB replica;
+    contact_db_init(&replica, nullptr);
+    ReplicaApplier applier;
+    replica_applier_init(&applier, &replica, 0);
+
+    ChangeEvent event = {};
+    event.seq = 1;
+    event.type = CHANGE_DELETE;
+    strcpy(event.contact.name, "Missing");
+    strcpy(event.contact.phone, "1");
+    strcpy(event.contact.email, "missing@gmail.com");
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_ERROR);
+    REQUIRE(applier.applied_seq == 0);
+
+    event.type = CHANGE_ADD;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OK);
+    event.seq = 2;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_ERROR);
+    REQUIRE(applier.applied_seq == 1);
+
+    // The contacts of a snapshot only come after its beginning, and no event comes before its end
+    event.type = CHANGE_SNAPSHOT_CONTACT;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_ERROR);
+    event.type = CHANGE_SNAPSHOT_BEGIN;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_OK);
+    event.type = CHANGE_ADD;
+    REQUIRE(replica_apply(&applier, &event) == CHANGE_FEED_ERROR);
+
+    contact_db_free(&replica);
+}
+
+TEST_CASE("Replica null test", "[replica]") {
+    ContactDB replica;
+    contact_db_init(&replica, nullptr);
+    ReplicaApplier applier;
+    ChangeEvent event = {};
+
+    REQUIRE(replica_applier_init(nullptr, &replica, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_applier_init(&applier, nullptr, 0) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_applier_init(&applier, &replica, 0) == CHANGE_FEED_OK);
+    REQUIRE(replica_apply(nullptr, &event) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_apply(&applier, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_catch_up(&applier, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_catch_up_stream(&applier, nullptr) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_resync(nullptr, &replica) == CHANGE_FEED_ERROR);
+    REQUIRE(replica_resync(&applier, nullptr) == CHANGE_FEED_ERROR);
+    replica_applier_set_source(nullptr, &replica);
+
+    contact_db_free(&replica);
+}